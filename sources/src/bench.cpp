@@ -0,0 +1,646 @@
+/*
+Rodent, a UCI chess playing engine derived from Sungorus 1.4
+Copyright (C) 2009-2011 Pablo Vazquez (Sungorus author)
+Copyright (C) 2011-2016 Pawel Koziol
+
+Rodent is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published
+by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+Rodent is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Benchmark harness. Each position is searched from a clean state with
+// the same limits, and the results are reported per position: nodes, time,
+// speed, time at which every iteration was completed and the best move.
+// Node counts and best moves are folded into a signature, which changes
+// whenever the search does. Results can be written as JSON and compared
+// against a stored baseline, flagging a change of signature or a slowdown.
+//
+// bench [<depth>] [depth <d>] [nodes <n>] [movetime <ms>] [file <fen file>]
+//       [repeat <n>] [json <file>|-] [baseline <file>] [tolerance <percent>]
+//
+// Search is single-threaded. Under depth or node limits every repeat must
+// reproduce the node counts of the first run, otherwise the run fails.
+//
+// Microbenchmarks time single primitives (attack lookups, move generation,
+// making moves, static exchange, evaluation, hash tables) on the positions
+// of the bench suite, so that each one can be optimized in isolation.
+//
+// microbench [samples <n>] [ms <time per sample>]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#if defined(_WIN32) || defined(_WIN64)
+#  include <windows.h>
+#else
+#  include <time.h>
+#endif
+#include "rodent.h"
+#include "timer.h"
+#include "book.h"
+
+#define MAX_BENCH_POS 256
+
+typedef struct {
+  char fen[128];
+  U64 nodes;
+  int time;        // best time of all repeats
+  int time_total;  // sum of times of all repeats
+  int depth;
+  int move;
+  int ttd[MAX_PLY + 1];
+} BENCH_POS;
+
+static const char *bench_suite[] = {
+  "r1bqkbnr/pp1ppppp/2n5/2p5/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq -",
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+  "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -",
+  "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+  "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+  "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+  "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+  "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+  "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+  "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+  "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+  "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+  "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+  "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+  "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+  "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+  NULL
+}; // test positions taken from DiscoCheck by Lucas Braesch
+
+// FNV-1a hash of node counts and best moves
+
+static U64 BenchSignature(BENCH_POS *pos, int cnt) {
+
+  U64 sig = 14695981039346656037ULL;
+
+  for (int i = 0; i < cnt; i++) {
+    U64 data[2] = { pos[i].nodes, (U64)pos[i].move };
+    unsigned char *bytes = (unsigned char *)data;
+    for (int j = 0; j < (int)sizeof(data); j++) {
+      sig ^= bytes[j];
+      sig *= 1099511628211ULL;
+    }
+  }
+  return sig;
+}
+
+static int BenchNps(U64 nodes, int time) {
+  return (int)((nodes * 1000) / (time + 1));
+}
+
+#ifdef USE_SEARCH_STATS
+
+// Search statistics (see stats.cpp) as raw counters
+
+static void BenchWriteStats(FILE *f) {
+
+#if defined _WIN32 || defined _WIN64
+#define U64_FMT "%I64u"
+#else
+#define U64_FMT "%llu"
+#endif
+
+  fprintf(f, "  \"search_stats\": {\n");
+  fprintf(f, "    \"nodes\": " U64_FMT ", \"iid\": " U64_FMT ", \"beta_prunes\": " U64_FMT ",\n",
+          stats.nodes, stats.iid, stats.beta_prunes);
+  fprintf(f, "    \"null_tried\": " U64_FMT ", \"null_cuts\": " U64_FMT ", \"null_verified\": " U64_FMT ", \"verify_fails\": " U64_FMT ",\n",
+          stats.null_tried, stats.null_cuts, stats.null_verified, stats.verify_fails);
+  fprintf(f, "    \"razor_tried\": " U64_FMT ", \"razor_cuts\": " U64_FMT ", \"fut_prunes\": " U64_FMT ", \"lmp_prunes\": " U64_FMT ",\n",
+          stats.razor_tried, stats.razor_cuts, stats.fut_prunes, stats.lmp_prunes);
+  fprintf(f, "    \"lmr_reductions\": " U64_FMT ", \"lmr_researches\": " U64_FMT ",\n",
+          stats.lmr_reductions, stats.lmr_researches);
+  fprintf(f, "    \"cutoffs\": " U64_FMT ", \"first_cutoffs\": " U64_FMT ", \"cutoff_index_sum\": " U64_FMT ",\n",
+          stats.cutoffs, stats.first_cutoffs, stats.cutoff_index);
+  fprintf(f, "    \"qc_nodes\": " U64_FMT ", \"qc_stand_pat\": " U64_FMT ", \"qc_tt_cuts\": " U64_FMT ", \"qc_cutoffs\": " U64_FMT ",\n",
+          stats.qc_nodes, stats.qc_stand_pat, stats.qc_tt_cuts, stats.qc_cutoffs);
+
+  int last = 0;
+  for (int d = 1; d < MAX_PLY; d++)
+    if (stats.tt_probes[d]) last = d;
+  fprintf(f, "    \"tt_probes_by_depth\": [");
+  for (int d = 1; d <= last; d++)
+    fprintf(f, d > 1 ? ", " U64_FMT : U64_FMT, stats.tt_probes[d]);
+  fprintf(f, "],\n    \"tt_cuts_by_depth\": [");
+  for (int d = 1; d <= last; d++)
+    fprintf(f, d > 1 ? ", " U64_FMT : U64_FMT, stats.tt_cuts[d]);
+  fprintf(f, "]\n  },\n");
+
+#undef U64_FMT
+}
+
+#endif
+
+static void BenchWriteJson(FILE *f, BENCH_POS *pos, int cnt, int depth, int node_limit,
+                           int move_time, int repeat, U64 total_nodes, int total_time, U64 sig) {
+
+  char move_str[6];
+
+  fprintf(f, "{\n");
+  fprintf(f, "  \"engine\": \"%s\",\n", PROG_NAME);
+  fprintf(f, "  \"limits\": { \"depth\": %d, \"nodes\": %d, \"movetime\": %d },\n", depth, node_limit, move_time);
+  fprintf(f, "  \"repeat\": %d,\n", repeat);
+  fprintf(f, "  \"positions\": [\n");
+  for (int i = 0; i < cnt; i++) {
+    MoveToStr(pos[i].move, move_str);
+#if defined _WIN32 || defined _WIN64
+    fprintf(f, "    { \"fen\": \"%s\", \"nodes\": %I64u, ", pos[i].fen, pos[i].nodes);
+#else
+    fprintf(f, "    { \"fen\": \"%s\", \"nodes\": %llu, ", pos[i].fen, pos[i].nodes);
+#endif
+    fprintf(f, "\"time_ms\": %d, \"time_ms_avg\": %d, \"nps\": %d, \"depth\": %d, \"bestmove\": \"%s\", \"ttd_ms\": [",
+            pos[i].time, pos[i].time_total / repeat, BenchNps(pos[i].nodes, pos[i].time), pos[i].depth, move_str);
+    for (int d = 1; d <= pos[i].depth; d++)
+      fprintf(f, d > 1 ? ", %d" : "%d", pos[i].ttd[d]);
+    fprintf(f, "] }%s\n", i < cnt - 1 ? "," : "");
+  }
+  fprintf(f, "  ],\n");
+#ifdef USE_SEARCH_STATS
+  BenchWriteStats(f);
+#endif
+#if defined _WIN32 || defined _WIN64
+  fprintf(f, "  \"total\": { \"nodes\": %I64u, \"time_ms\": %d, \"nps\": %d, \"signature\": \"%016I64x\" }\n",
+#else
+  fprintf(f, "  \"total\": { \"nodes\": %llu, \"time_ms\": %d, \"nps\": %d, \"signature\": \"%016llx\" }\n",
+#endif
+          total_nodes, total_time, BenchNps(total_nodes, total_time), sig);
+  fprintf(f, "}\n");
+}
+
+// Reads totals from JSON written by BenchWriteJson(). Returns 0 on failure.
+
+static int BenchReadBaseline(char *file_name, int *nps, char *sig) {
+
+  char buf[1 << 16], *ptr;
+  FILE *f = fopen(file_name, "r");
+
+  if (f == NULL) return 0;
+  int len = fread(buf, 1, sizeof(buf) - 1, f);
+  fclose(f);
+  buf[len] = '\0';
+
+  if ((ptr = strstr(buf, "\"total\"")) == NULL) return 0;
+  if ((ptr = strstr(ptr, "\"nps\":")) == NULL) return 0;
+  *nps = atoi(ptr + 6);
+  if ((ptr = strstr(ptr, "\"signature\": \"")) == NULL) return 0;
+  strncpy(sig, ptr + 14, 16);
+  sig[16] = '\0';
+  return 1;
+}
+
+// @Bench() returns 0 if the run passed or 1 if repeats did not reproduce
+// the node counts or the comparison with a baseline failed
+
+int Bench(char *ptr) {
+
+  POS p[1];
+  int pv[MAX_PLY];
+  char token[180], line[256], move_str[6];
+  char file_name[256] = "", json_name[256] = "", baseline_name[256] = "";
+  int depth = 0, node_limit = 0, move_time = 0, repeat = 1, tolerance = 3;
+  int cnt = 0, total_time = 0, result = 0;
+  U64 total_nodes = 0;
+
+  for (;;) {
+    ptr = ParseToken(ptr, token);
+    if (*token == '\0')
+      break;
+    if (*token >= '0' && *token <= '9') {  // "bench 10" is the same as "bench depth 10"
+      depth = atoi(token);
+      continue;
+    }
+    if (strcmp(token, "file") == 0)           ptr = ParseToken(ptr, file_name);
+    else if (strcmp(token, "json") == 0)      ptr = ParseToken(ptr, json_name);
+    else if (strcmp(token, "baseline") == 0)  ptr = ParseToken(ptr, baseline_name);
+    else {
+      char name[180];
+      strcpy(name, token);
+      ptr = ParseToken(ptr, token);
+      if (strcmp(name, "depth") == 0)          depth = atoi(token);
+      else if (strcmp(name, "nodes") == 0)     node_limit = atoi(token);
+      else if (strcmp(name, "movetime") == 0)  move_time = atoi(token);
+      else if (strcmp(name, "repeat") == 0)    repeat = Max(1, atoi(token));
+      else if (strcmp(name, "tolerance") == 0) tolerance = atoi(token);
+      else printf("info string unknown bench option %s, ignored\n", name);
+    }
+  }
+
+  if (depth == 0 && node_limit == 0 && move_time == 0) depth = 8; // so that you can call bench without parameters
+  if (depth == 0) depth = MAX_PLY;
+
+  // Collect positions
+
+  BENCH_POS *pos = (BENCH_POS *) calloc(MAX_BENCH_POS, sizeof(BENCH_POS));
+
+  if (file_name[0]) {
+    FILE *f = fopen(file_name, "r");
+    if (f == NULL) {
+      printf("info string cannot open %s\n", file_name);
+      free(pos);
+      return 1;
+    }
+    for (int line_no = 1; fgets(line, sizeof(line), f) && cnt < MAX_BENCH_POS; line_no++) {
+      line[strcspn(line, "\r\n")] = '\0';
+      if (line[0] == '\0' || line[0] == '#') continue;
+      if (strlen(line) >= sizeof(pos[0].fen)) {
+        printf("info string line %d is too long for a position, skipped\n", line_no);
+        continue;
+      }
+      strcpy(pos[cnt++].fen, line);
+    }
+    fclose(f);
+  } else {
+    for (int i = 0; bench_suite[i]; i++)
+      strcpy(pos[cnt++].fen, bench_suite[i]);
+  }
+
+  printf("Bench test started (depth %d, nodes %d, movetime %d, %d position(s), repeat %d):\n",
+         depth, node_limit, move_time, cnt, repeat);
+
+  verbose = 0;
+  search_moves_cnt = 0;
+  ClearSearchStats();
+  ClearEvalProfile();
+
+  for (int r = 0; r < repeat; r++) {
+
+    // Every run starts from the same state, so that node counts repeat
+
+    ResetEngine();
+
+    for (int i = 0; i < cnt; i++) {
+      Timer.Clear();
+      Timer.SetData(MAX_DEPTH, depth);
+      Timer.SetData(MAX_NODES, node_limit);
+      Timer.SetData(MOVE_TIME, move_time);
+      if (!move_time) Timer.SetData(FLAG_INFINITE, 1);
+      Timer.SetMoveTiming();
+
+      SetPosition(p, pos[i].fen);
+      nodes = 0;
+      abort_search = 0;
+      Timer.SetStartTime();
+      Iterate(p, pv);
+      int elapsed = Timer.GetElapsedTime();
+
+      pos[i].time_total += elapsed;
+      if (r == 0 || elapsed < pos[i].time) pos[i].time = elapsed;
+      if (r > 0 && !move_time && nodes != pos[i].nodes) {
+#if defined _WIN32 || defined _WIN64
+        printf("info string position %d: %I64u nodes in run %d, %I64u in run 1\n",
+#else
+        printf("info string position %d: %llu nodes in run %d, %llu in run 1\n",
+#endif
+               i + 1, nodes, r + 1, pos[i].nodes);
+        result = 1;
+      }
+      if (r == 0) pos[i].nodes = nodes;
+      pos[i].move = pv[0];
+      pos[i].depth = depth_reached;
+      for (int d = 1; d <= depth_reached; d++)
+        pos[i].ttd[d] = depth_time[d];
+    }
+  }
+
+  // Report
+
+  for (int i = 0; i < cnt; i++) {
+    total_nodes += pos[i].nodes;
+    total_time += pos[i].time;
+    MoveToStr(pos[i].move, move_str);
+#if defined _WIN32 || defined _WIN64
+    printf("%3d: %12I64u nodes %7d ms %9d nps depth %2d bestmove %s\n",
+#else
+    printf("%3d: %12llu nodes %7d ms %9d nps depth %2d bestmove %s\n",
+#endif
+           i + 1, pos[i].nodes, pos[i].time, BenchNps(pos[i].nodes, pos[i].time), pos[i].depth, move_str);
+  }
+
+  U64 sig = BenchSignature(pos, cnt);
+  int nps = BenchNps(total_nodes, total_time);
+
+#if defined _WIN32 || defined _WIN64
+  printf("%I64u nodes searched in %d, speed %u nps, signature %016I64x\n", total_nodes, total_time, nps, sig);
+#else
+  printf("%llu nodes searched in %d, speed %u nps, signature %016llx\n", total_nodes, total_time, nps, sig);
+#endif
+
+#ifdef USE_SEARCH_STATS
+  PrintSearchStats();
+#endif
+#ifdef USE_EVAL_PROFILE
+  PrintEvalProfile();
+#endif
+
+  if (json_name[0]) {
+    FILE *f = strcmp(json_name, "-") == 0 ? stdout : fopen(json_name, "w");
+    if (f == NULL)
+      printf("info string cannot write %s\n", json_name);
+    else {
+      BenchWriteJson(f, pos, cnt, depth, node_limit, move_time, repeat, total_nodes, total_time, sig);
+      if (f != stdout) fclose(f);
+    }
+  }
+
+  // Compare with a baseline. Signature differs if the search has changed
+  // (or if the limits are not deterministic), while speed is checked
+  // against given tolerance.
+
+  if (baseline_name[0]) {
+    int base_nps;
+    char base_sig[20], sig_str[20];
+
+    if (!BenchReadBaseline(baseline_name, &base_nps, base_sig)) {
+      printf("info string cannot read baseline %s\n", baseline_name);
+      result = 1;
+    } else {
+#if defined _WIN32 || defined _WIN64
+      sprintf(sig_str, "%016I64x", sig);
+#else
+      sprintf(sig_str, "%016llx", sig);
+#endif
+      if (strcmp(sig_str, base_sig) != 0)
+        printf("info string signature %s differs from baseline %s\n", sig_str, base_sig);
+
+      double change = base_nps ? 100.0 * (nps - base_nps) / base_nps : 0.0;
+      printf("info string speed %d nps, baseline %d nps (%+.1f%%)\n", nps, base_nps, change);
+
+      if (change < -tolerance) {
+        printf("info string SLOWDOWN: more than %d%% below baseline\n", tolerance);
+        result = 1;
+      }
+    }
+  }
+
+  free(pos);
+  return result;
+}
+
+// Microbenchmark corpus: bench positions with their pseudo-legal moves
+// (captures first), and pseudo-random keys for hash table tests
+
+#define MB_KEYS (1 << 16)
+
+static POS mb_pos[MAX_BENCH_POS];
+static int mb_moves[MAX_BENCH_POS][MAX_MOVES];
+static int mb_capt_cnt[MAX_BENCH_POS];
+static int mb_move_cnt[MAX_BENCH_POS];
+static int mb_cnt;
+static U64 mb_keys[MB_KEYS];
+static U64 mb_sink;  // results are folded here, so that the compiler cannot skip the work
+
+// Monotonic clock in nanoseconds; Timer.GetMS() is too coarse for this
+
+static U64 MicroNs(void) {
+
+#if defined(_WIN32) || defined(_WIN64)
+  LARGE_INTEGER cnt, freq;
+  QueryPerformanceCounter(&cnt);
+  QueryPerformanceFrequency(&freq);
+  return (U64)(cnt.QuadPart * (1e9 / freq.QuadPart));
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (U64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+// Each test makes one pass over the corpus and returns the number of operations
+
+static int MbRookAttacks(void) {
+
+  for (int i = 0; i < mb_cnt; i++) {
+    U64 occ = OccBb(&mb_pos[i]);
+    for (int sq = 0; sq < 64; sq++)
+      mb_sink += BB.RookAttacks(occ, sq);
+  }
+  return mb_cnt * 64;
+}
+
+static int MbBishAttacks(void) {
+
+  for (int i = 0; i < mb_cnt; i++) {
+    U64 occ = OccBb(&mb_pos[i]);
+    for (int sq = 0; sq < 64; sq++)
+      mb_sink += BB.BishAttacks(occ, sq);
+  }
+  return mb_cnt * 64;
+}
+
+static int MbGenerateCaptures(void) {
+
+  int list[MAX_MOVES];
+
+  for (int i = 0; i < mb_cnt; i++)
+    mb_sink += GenerateCaptures(&mb_pos[i], list) - list;
+  return mb_cnt;
+}
+
+static int MbGenerateQuiet(void) {
+
+  int list[MAX_MOVES];
+
+  for (int i = 0; i < mb_cnt; i++)
+    mb_sink += GenerateQuiet(&mb_pos[i], list) - list;
+  return mb_cnt;
+}
+
+static int MbDoUndo(void) {
+
+  UNDO u[1];
+  int ops = 0;
+
+  for (int i = 0; i < mb_cnt; i++) {
+    POS *p = &mb_pos[i];
+    for (int j = 0; j < mb_move_cnt[i]; j++) {
+      p->DoMove(mb_moves[i][j], u);
+      mb_sink += p->hash_key;
+      p->UndoMove(mb_moves[i][j], u);
+    }
+    ops += mb_move_cnt[i];
+  }
+  return ops;
+}
+
+static int MbSwap(void) {
+
+  int ops = 0;
+
+  for (int i = 0; i < mb_cnt; i++) {
+    for (int j = 0; j < mb_capt_cnt[i]; j++)
+      mb_sink += Swap(&mb_pos[i], Fsq(mb_moves[i][j]), Tsq(mb_moves[i][j]));
+    ops += mb_capt_cnt[i];
+  }
+  return ops;
+}
+
+static int MbEval(void) {
+
+  eData e;
+
+  for (int i = 0; i < mb_cnt; i++)
+    mb_sink += Eval.Return(&mb_pos[i], &e, 0);
+  return mb_cnt;
+}
+
+static int MbEvalHash(void) {
+
+  eData e;
+
+  for (int i = 0; i < mb_cnt; i++)
+    mb_sink += Eval.Return(&mb_pos[i], &e, 1);
+  return mb_cnt;
+}
+
+static int MbTransStore(void) {
+
+  for (int i = 0; i < MB_KEYS; i++)
+    TransStore(mb_keys[i], i, i & 255, EXACT, i & 15, 0);
+  return MB_KEYS;
+}
+
+static int MbTransRetrieve(void) {
+
+  int move, score;
+
+  for (int i = 0; i < MB_KEYS; i++)
+    mb_sink += TransRetrieve(mb_keys[i], &move, &score, -INF, INF, 0, 0);
+  return MB_KEYS;
+}
+
+static int MbPolyglotKey(void) {
+
+  for (int i = 0; i < mb_cnt; i++)
+    mb_sink += GuideBook.GetPolyglotKey(&mb_pos[i]);
+  return mb_cnt;
+}
+
+// Times one test: the number of passes is chosen so that a sample takes
+// about sample_ms, then mean, standard deviation and minimum of time per
+// operation are reported over all samples
+
+static void MicroRun(const char *name, int (*test)(void), int samples, int sample_ms) {
+
+  U64 start, elapsed;
+  int passes = 0, ops = 0;
+  double ns[64], sum = 0.0, sq_sum = 0.0, best = 0.0;
+
+  start = MicroNs();
+  do {
+    ops = test();
+    passes++;
+  } while ((elapsed = MicroNs() - start) < 1000000);
+
+  passes = Max(1, (int)(passes * (sample_ms * 1e6) / elapsed));
+
+  for (int s = 0; s < samples; s++) {
+    start = MicroNs();
+    for (int i = 0; i < passes; i++)
+      test();
+    ns[s] = (double)(MicroNs() - start) / ((double)passes * ops);
+    sum += ns[s];
+    if (s == 0 || ns[s] < best) best = ns[s];
+  }
+
+  double mean = sum / samples;
+  for (int s = 0; s < samples; s++)
+    sq_sum += (ns[s] - mean) * (ns[s] - mean);
+  double dev = samples > 1 ? sqrt(sq_sum / (samples - 1)) : 0.0;
+
+  printf("%-18s %10.2f ns/op +- %7.2f (%5.1f%%)  min %10.2f  ops/pass %d\n",
+         name, mean, dev, mean > 0 ? 100.0 * dev / mean : 0.0, best, ops);
+}
+
+void MicroBench(char *ptr) {
+
+  char token[180];
+  int samples = 10, sample_ms = 20;
+  int list[MAX_MOVES];
+
+  for (;;) {
+    ptr = ParseToken(ptr, token);
+    if (*token == '\0')
+      break;
+    if (strcmp(token, "samples") == 0) {
+      ptr = ParseToken(ptr, token);
+      samples = Max(1, Min(64, atoi(token)));
+    } else if (strcmp(token, "ms") == 0) {
+      ptr = ParseToken(ptr, token);
+      sample_ms = Max(1, atoi(token));
+    }
+  }
+
+  // Set up the corpus
+
+  mb_cnt = 0;
+  for (int i = 0; bench_suite[i]; i++) {
+    POS *p = &mb_pos[mb_cnt];
+    SetPosition(p, (char *)bench_suite[i]);
+    int *last = GenerateCaptures(p, list);
+    mb_capt_cnt[mb_cnt] = last - list;
+    last = GenerateQuiet(p, last);
+    mb_move_cnt[mb_cnt] = last - list;
+    for (int j = 0; j < mb_move_cnt[mb_cnt]; j++)
+      mb_moves[mb_cnt][j] = list[j];
+    mb_cnt++;
+  }
+
+  U64 key = 0x9E3779B97F4A7C15ULL;
+  for (int i = 0; i < MB_KEYS; i++) {  // xorshift64
+    key ^= key << 13;
+    key ^= key >> 7;
+    key ^= key << 17;
+    mb_keys[i] = key;
+  }
+
+  fl_tables_used = 1;
+  SetAsymmetricEval(WC);
+  mb_sink = 0;
+
+  printf("Microbench started (%d positions, %d samples of %d ms, %s sliders):\n",
+         mb_cnt, samples, sample_ms, BB.use_pext ? "pext" : "magic");
+
+  // Sliding attacks are timed with each indexing available in this build
+
+  int pext = BB.use_pext;
+  for (int use_pext = 0; use_pext <= 1; use_pext++) {
+    BB.SelectSliders(use_pext);
+    if (BB.use_pext != use_pext) break;  // no PEXT in this build
+    MicroRun(use_pext ? "RookAttacks pext" : "RookAttacks magic", MbRookAttacks, samples, sample_ms);
+    MicroRun(use_pext ? "BishAttacks pext" : "BishAttacks magic", MbBishAttacks, samples, sample_ms);
+  }
+  BB.SelectSliders(pext);
+
+  MicroRun("GenerateCaptures", MbGenerateCaptures, samples, sample_ms);
+  MicroRun("GenerateQuiet",    MbGenerateQuiet,    samples, sample_ms);
+  MicroRun("DoMove+UndoMove",  MbDoUndo,           samples, sample_ms);
+  MicroRun("Swap",             MbSwap,             samples, sample_ms);
+  MicroRun("Eval (no hash)",   MbEval,             samples, sample_ms);
+  MicroRun("Eval (hash)",      MbEvalHash,         samples, sample_ms);
+  MicroRun("TransStore",       MbTransStore,       samples, sample_ms);
+  MicroRun("TransRetrieve",    MbTransRetrieve,    samples, sample_ms);
+  MicroRun("GetPolyglotKey",   MbPolyglotKey,      samples, sample_ms);
+
+  // Tests have filled the hash tables with junk
+
+  ResetEngine();
+
+#if defined _WIN32 || defined _WIN64
+  printf("checksum %016I64x\n", mb_sink);
+#else
+  printf("checksum %016llx\n", mb_sink);
+#endif
+}
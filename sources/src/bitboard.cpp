@@ -17,63 +17,87 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <string.h>
 #include "rodent.h"
 #include "magicmoves.h"
 
 #define USE_MAGIC
 #define USE_MM_POPCNT
 
-void cBitBoard::Init() {
-
-#ifdef USE_MAGIC
-  initmagicmoves();
+// Builds with BMI2 (make build ARCH=bmi2) can index sliding attack tables
+// with PEXT instead of magic multiplication. It is chosen at startup if cpu
+// executes PEXT fast; otherwise magic indexing is used. Builds without
+// BMI2 always use magics, since a function compiled for BMI2 could not be
+// inlined into the rest of the engine. USE_PEXT comes from magicmoves.h,
+// as both kinds of tables are generated in magicmoves.c.
+
+#ifdef USE_PEXT
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
 #endif
 
-  // init pawn attacks
+#ifdef USE_PEXT
 
-  for (int sq = 0; sq < 64; sq++) {
-    p_attacks[WC][sq] = ShiftNE(SqBb(sq)) | ShiftNW(SqBb(sq));
-    p_attacks[BC][sq] = ShiftSE(SqBb(sq)) | ShiftSW(SqBb(sq));
-  }
- 
-  // init knight attacks
+// BMI2 is present on Intel since Haswell, but AMD cpus before Zen 3
+// (family 19h) execute PEXT in microcode, much slower than a multiplication
 
-  for (int sq = 0; sq < 64; sq++) {
-	U64 bb_west = ShiftWest(SqBb(sq));
-	U64 bb_east = ShiftEast(SqBb(sq));
-	n_attacks[sq] = (bb_east | bb_west) << 16;
-	n_attacks[sq] |= (bb_east | bb_west) >> 16;
-	bb_west = ShiftWest(bb_west);
-	bb_east = ShiftEast(bb_east);
-	n_attacks[sq] |= (bb_east | bb_west) << 8;
-	n_attacks[sq] |= (bb_east | bb_west) >> 8;
-  }
+static int CpuHasFastPext(void) {
 
-  // init king attacks
+  unsigned int regs[4], vendor[3];
 
-  for (int sq = 0; sq < 64; sq++) {
-    k_attacks[sq] = SqBb(sq);
-	k_attacks[sq] |= ShiftSideways(k_attacks[sq]);
-    k_attacks[sq] |= (ShiftNorth(k_attacks[sq]) | ShiftSouth(k_attacks[sq]));
-  }
+#if defined(_MSC_VER)
+  __cpuid((int *)regs, 0);
+#else
+  __get_cpuid(0, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+  if (regs[0] < 7) return 0;
+  vendor[0] = regs[1]; vendor[1] = regs[3]; vendor[2] = regs[2];
+  int is_amd = (memcmp(vendor, "AuthenticAMD", 12) == 0);
 
-  for (int sq1 = 0; sq1 < 64; sq1++) {
-    for (int sq2 = 0; sq2 < 64; sq2++) {
-      bbBetween[sq1][sq2] = GetBetween(sq1, sq2);
-    }
-  }
+#if defined(_MSC_VER)
+  __cpuid((int *)regs, 1);
+#else
+  __get_cpuid(1, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+  int family = (regs[0] >> 8) & 15;
+  if (family == 15) family += (regs[0] >> 20) & 255;
+
+#if defined(_MSC_VER)
+  __cpuidex((int *)regs, 7, 0);
+#else
+  __get_cpuid_count(7, 0, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+  int has_bmi2 = (regs[1] >> 8) & 1;
 
+  return has_bmi2 && !(is_amd && family < 0x19);
 }
 
+#endif
+
+// Attacks of pawns, knights and kings and squares between two squares are
+// generated at compile time, like sliding attacks in magicmoves.c, so that
+// they are placed in read-only data shared by all engine processes
+
+typedef struct {
+  U64 p_attacks[2][64];
+  U64 n_attacks[64];
+  U64 k_attacks[64];
+  U64 between[64][64];
+} BB_TABLES;
+
 // from chessprogramming wiki
 
-U64 cBitBoard::GetBetween(int sq1, int sq2) {
+static constexpr U64 GetBetween(int sq1, int sq2) {
 
   const U64 m1 = C64(-1);
   const U64 a2a7 = C64(0x0001010101010100);
   const U64 b2g7 = C64(0x0040201008040200);
   const U64 h1b7 = C64(0x0002040810204080); /* Thanks Dustin, g2b7 did not work for c1-a3 */
-  U64 btwn, line, rank, file;
+  U64 btwn = 0, line = 0, rank = 0, file = 0;
 
   btwn = (m1 << sq1) ^ (m1 << sq2);
   file = (sq2 & 7) - (sq1 & 7);
@@ -86,6 +110,68 @@ U64 cBitBoard::GetBetween(int sq1, int sq2) {
   return line & btwn;   /* return the bits on that line in-between */
 }
 
+static constexpr BB_TABLES InitTables(void) {
+
+  BB_TABLES t{};
+
+  // init pawn attacks
+
+  for (int sq = 0; sq < 64; sq++) {
+    t.p_attacks[WC][sq] = ShiftNE(SqBb(sq)) | ShiftNW(SqBb(sq));
+    t.p_attacks[BC][sq] = ShiftSE(SqBb(sq)) | ShiftSW(SqBb(sq));
+  }
+
+  // init knight attacks
+
+  for (int sq = 0; sq < 64; sq++) {
+    U64 bb_west = ShiftWest(SqBb(sq));
+    U64 bb_east = ShiftEast(SqBb(sq));
+    t.n_attacks[sq] = (bb_east | bb_west) << 16;
+    t.n_attacks[sq] |= (bb_east | bb_west) >> 16;
+    bb_west = ShiftWest(bb_west);
+    bb_east = ShiftEast(bb_east);
+    t.n_attacks[sq] |= (bb_east | bb_west) << 8;
+    t.n_attacks[sq] |= (bb_east | bb_west) >> 8;
+  }
+
+  // init king attacks
+
+  for (int sq = 0; sq < 64; sq++) {
+    U64 bb = SqBb(sq);
+    bb |= ShiftWest(bb) | ShiftEast(bb);
+    t.k_attacks[sq] = bb | ShiftNorth(bb) | ShiftSouth(bb);
+  }
+
+  for (int sq1 = 0; sq1 < 64; sq1++)
+    for (int sq2 = 0; sq2 < 64; sq2++)
+      t.between[sq1][sq2] = GetBetween(sq1, sq2);
+
+  return t;
+}
+
+static constexpr BB_TABLES bb_tables = InitTables();
+
+// @SelectSliders() chooses between magic and PEXT indexing of sliding attacks
+
+void cBitBoard::SelectSliders(int pext) {
+
+#ifdef USE_PEXT
+  use_pext = pext;
+#else
+  (void)pext;
+  use_pext = 0;
+#endif
+}
+
+void cBitBoard::Init() {
+
+#ifdef USE_PEXT
+  SelectSliders(CpuHasFastPext());
+#else
+  SelectSliders(0);
+#endif
+}
+
 #if defined(__GNUC__)
 
 int cBitBoard::PopCnt(U64 bb) {
@@ -186,7 +272,7 @@ U64 cBitBoard::ShiftSideways(U64 bb) {
 }
 
 U64 cBitBoard::PawnAttacks(int sd, int sq) {
-  return p_attacks[sd][sq];
+  return bb_tables.p_attacks[sd][sq];
 }
 
 U64 cBitBoard::FillOcclSouth(U64 bbStart, U64 bbBlock) {
@@ -276,12 +362,15 @@ U64 cBitBoard::FillOcclNW(U64 bbStart, U64 bbBlock) {
 }
 
 U64 cBitBoard::KnightAttacks(int sq) {
-  return n_attacks[sq];
+  return bb_tables.n_attacks[sq];
 }
 
 U64 cBitBoard::RookAttacks(U64 bbOcc, int sq) {
 
 #ifdef USE_MAGIC
+#ifdef USE_PEXT
+  if (use_pext) return pextmoves_r_indices[sq][_pext_u64(bbOcc, magicmoves_r_mask[sq])];
+#endif
   return Rmagic(sq, bbOcc);
 #else
   U64 bbStart = SqBb(sq);
@@ -295,6 +384,9 @@ U64 cBitBoard::RookAttacks(U64 bbOcc, int sq) {
 
 U64 cBitBoard::BishAttacks(U64 bbOcc, int sq) {
 #ifdef USE_MAGIC
+#ifdef USE_PEXT
+  if (use_pext) return pextmoves_b_indices[sq][_pext_u64(bbOcc, magicmoves_b_mask[sq])];
+#endif
   return Bmagic(sq, bbOcc);
 #else
   U64 bbStart = SqBb(sq);
@@ -309,6 +401,9 @@ U64 cBitBoard::BishAttacks(U64 bbOcc, int sq) {
 U64 cBitBoard::QueenAttacks(U64 bbOcc, int sq) {
 
 #ifdef USE_MAGIC
+#ifdef USE_PEXT
+  if (use_pext) return RookAttacks(bbOcc, sq) | BishAttacks(bbOcc, sq);
+#endif
   return Rmagic(sq, bbOcc) | Bmagic(sq, bbOcc);
 #else
   return RookAttacks(bbOcc, sq) | BishAttacks(bbOcc, sq);
@@ -316,5 +411,9 @@ U64 cBitBoard::QueenAttacks(U64 bbOcc, int sq) {
 }
 
 U64 cBitBoard::KingAttacks(int sq) {
-	return k_attacks[sq];
+	return bb_tables.k_attacks[sq];
+}
+
+U64 cBitBoard::Between(int sq1, int sq2) {
+  return bb_tables.between[sq1][sq2];
 }
\ No newline at end of file
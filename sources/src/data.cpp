@@ -19,7 +19,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "rodent.h"
 
-int castle_mask[64];
+const int castle_mask[64] = {
+  13, 15, 15, 15, 12, 15, 15, 14,
+  15, 15, 15, 15, 15, 15, 15, 15,
+  15, 15, 15, 15, 15, 15, 15, 15,
+  15, 15, 15, 15, 15, 15, 15, 15,
+  15, 15, 15, 15, 15, 15, 15, 15,
+  15, 15, 15, 15, 15, 15, 15, 15,
+  15, 15, 15, 15, 15, 15, 15, 15,
+   7, 15, 15, 15,  3, 15, 15, 11
+};
 const int bit_table[64] = {
    0,  1,  2,  7,  3, 13,  8, 19,
    4, 25, 14, 28,  9, 34, 20, 40,
@@ -31,17 +40,26 @@ const int bit_table[64] = {
   61, 22, 43, 51, 60, 42, 59, 58
 };
 //                         P    N    B    R    Q
-const int tp_value[7] = { 100, 325, 325, 500, 1000, 0, 0 }; // immutable, used in Swap()
+int tp_value[7] = { 100, 325, 325, 500, 1000, 0, 0 }; // used in SEE, follows Param.pc_value
 int history[12][64];
+int cont_hist[2][12][64][12][64];
+int capt_hist[12][64][6];
+STACK_ENTRY search_stack[MAX_PLY];
+int pv_table[PV_TABLE_SIZE];
 int refutation[64][64];
-int killer[MAX_PLY][2];
-U64 zob_piece[12][64];
-U64 zob_castle[16];
-U64 zob_ep[8];
 
 int pondering;
 int root_depth;
+int depth_reached;            // last completed iteration
+int depth_time[MAX_PLY + 1];  // time at which each iteration was completed
+int multi_pv;
+int pv_idx;
+ROOT_LIST root_list;
+int search_moves[MAX_MOVES];
+int search_moves_cnt;
 int fl_elo_slider;
+int fl_poll_input;  // check for commands during search
+int fl_tables_used; // hash and history tables were written since the last reset
 int time_percentage;
 int use_book;
 int book_filter;
@@ -52,19 +52,7 @@ int GetDrawFactor(POS *p, int sd)
 {
   int op = Opp(sd);
 
-  // Case 1: KPK with edge pawn (else KBPK recognizer would break)
-
-  if (PcMatNone(p, sd)
-  && PcMatNone(p, op)
-  && p->cnt[sd][P] == 1    // TODO: all pawns of a stronger side on a rim
-  && p->cnt[op][P] == 0) { // TODO: accept pawns for a weaker side
-
-    if (p->Pawns(sd) & FILE_H_BB
-    &&  p->Kings(op) & bbKingBlockH[sd]) return 0;
-
-    if (p->Pawns(sd) & FILE_A_BB
-    &&  p->Kings(op) & bbKingBlockA[sd]) return 0;
-  }
+  // Case 1: KPK is scored exactly in Eval.Return(), using a bitbase
 
   // Case 2: KBPK(P) draws with edge pawn and wrong bishop
 
@@ -29,48 +29,83 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 static const int max_phase = 24;
 const int phase_value[7] = { 0, 1, 1, 2, 4, 0, 0 };
 
+// bonus for a won KPK endgame, kept well below the value of a queen
+
+static const int kpk_win_bonus = 400;
+
 char *factor_name[] = { "Attack    ", "Mobility  ", "Pst       ", "Pawns     ", "Passers   ", "Tropism   ", "Outposts  ", "Lines     ", "Pressure  ", "Others    "};
 
 sEvalHashEntry EvalTT[EVAL_HASH_SIZE];
 
-void cMask::Init(void) {
+// Masks and distance tables are generated at compile time, so that they
+// are placed in read-only data shared by all engine processes
+
+static constexpr cMask InitMask(void) {
+
+  cMask m{};
 
   // Init mask for passed pawn detection
 
   for (int sq = 0; sq < 64; sq++) {
-    passed[WC][sq] = BB.FillNorthExcl(SqBb(sq));
-    passed[WC][sq] |= BB.ShiftSideways(passed[WC][sq]);
-    passed[BC][sq] = BB.FillSouthExcl(SqBb(sq));
-    passed[BC][sq] |= BB.ShiftSideways(passed[BC][sq]);
+    U64 north = 0, south = 0;
+    for (U64 bb = ShiftNorth(SqBb(sq)); bb; bb = ShiftNorth(bb)) north |= bb;
+    for (U64 bb = ShiftSouth(SqBb(sq)); bb; bb = ShiftSouth(bb)) south |= bb;
+    m.passed[WC][sq] = north | ShiftWest(north) | ShiftEast(north);
+    m.passed[BC][sq] = south | ShiftWest(south) | ShiftEast(south);
   }
 
   // Init adjacent mask for isolated pawns detection
 
   for (int f = 0; f < 8; f++) {
-    adjacent[f] = 0ULL;
-    if (f > 0) adjacent[f] |= FILE_A_BB << (f - 1);
-    if (f < 7) adjacent[f] |= FILE_A_BB << (f + 1);
+    m.adjacent[f] = 0ULL;
+    if (f > 0) m.adjacent[f] |= FILE_A_BB << (f - 1);
+    if (f < 7) m.adjacent[f] |= FILE_A_BB << (f + 1);
   }
 
   // Init supported mask for weak pawns detection
 
   for (int sq = 0; sq < 64; sq++) {
-    supported[WC][sq] = BB.ShiftSideways(SqBb(sq));
-    supported[WC][sq] |= BB.FillSouth(supported[WC][sq]);
-
-    supported[BC][sq] = BB.ShiftSideways(SqBb(sq));
-    supported[BC][sq] |= BB.FillNorth(supported[BC][sq]);
+    U64 side = ShiftWest(SqBb(sq)) | ShiftEast(SqBb(sq));
+    m.supported[WC][sq] = m.supported[BC][sq] = side;
+    for (U64 bb = side; bb; bb = ShiftSouth(bb)) m.supported[WC][sq] |= bb;
+    for (U64 bb = side; bb; bb = ShiftNorth(bb)) m.supported[BC][sq] |= bb;
   }
 
   // Init king zone
 
   for (int sq = 0; sq < 64; sq++) {
-    king_zone[WC][sq] = king_zone[BC][sq] = BB.KingAttacks(sq);
-    king_zone[WC][sq] |= ShiftSouth(king_zone[WC][sq]);
-    king_zone[BC][sq] |= ShiftNorth(king_zone[BC][sq]);
+    U64 king = SqBb(sq) | ShiftWest(SqBb(sq)) | ShiftEast(SqBb(sq));
+    king |= ShiftNorth(king) | ShiftSouth(king);
+    m.king_zone[WC][sq] = king | ShiftSouth(king);
+    m.king_zone[BC][sq] = king | ShiftNorth(king);
+  }
+
+  return m;
+}
+
+constexpr cMask Mask = InitMask();
+
+typedef struct {
+  int dist[64][64];           // table for evaluating king tropism
+  int chebyshev_dist[64][64]; // table for unstoppable passer detection
+} DIST_TABLES;
+
+static constexpr DIST_TABLES InitDist(void) {
+
+  DIST_TABLES t{};
+
+  for (int sq1 = 0; sq1 < 64; ++sq1) {
+    for (int sq2 = 0; sq2 < 64; ++sq2) {
+      int r_delta = Abs(Rank(sq1) - Rank(sq2));
+      int f_delta = Abs(File(sq1) - File(sq2));
+      t.dist[sq1][sq2] = 14 - (r_delta + f_delta);
+      t.chebyshev_dist[sq1][sq2] = Max(r_delta, f_delta);
+    }
   }
+  return t;
+}
 
-};
+static constexpr DIST_TABLES dist_tables = InitDist();
 
 void SetAsymmetricEval(int sd) {
 
@@ -111,19 +146,6 @@ void InitWeights(void) {
 
 void cParam::Default(void) {
 
-  int r_delta, f_delta;
-
-  // Init distance tables (for evaluating king tropism and unstoppable passers)
-
-  for (int sq1 = 0; sq1 < 64; ++sq1) {
-    for (int sq2 = 0; sq2 < 64; ++sq2) {
-      r_delta = Abs(Rank(sq1) - Rank(sq2));
-      f_delta = Abs(File(sq1) - File(sq2));
-      dist[sq1][sq2] = 14 - (r_delta + f_delta);
-      chebyshev_dist[sq1][sq2] = Max(r_delta, f_delta);
-    }
-  }
-
  // Init parameter values
 
   elo = 2850;
@@ -134,14 +156,14 @@ void cParam::Default(void) {
   pc_value[R] = 500;
   pc_value[Q] = 1000;
   pc_value[K] = 0;
-  pc_value[NO_PC] = 0;
+  pc_value[NO_TP] = 0;
   keep_pc[P] = 0;
   keep_pc[N] = 0;
   keep_pc[B] = 0;
   keep_pc[R] = 0;
   keep_pc[Q] = 0;
   keep_pc[K] = 0;
-  keep_pc[NO_PC] = 0;
+  keep_pc[NO_TP] = 0;
   pst_style = 0;
   mob_style = 0;
   mat_perc = 100;
@@ -201,6 +223,11 @@ void cParam::DynamicInit(void) {
   Eval.prog_side = NO_CL;
   ResetEngine();
 
+  // Static exchange evaluation uses the same piece values as eval
+
+  for (int tp = P; tp <= Q; tp++)
+    tp_value[tp] = pc_value[tp];
+
   // Init piece/square values together with material value of the pieces.
 
   for (int sq = 0; sq < 64; sq++) {
@@ -374,7 +401,7 @@ void cEval::ScorePieces(POS *p, eData *e, int sd) {
 
     // Knight tropism to enemy king
 
-    Add(e, sd, F_TROPISM, tropism_mg[N] * Param.dist[sq][ksq], tropism_eg[N] * Param.dist[sq][ksq]);
+    Add(e, sd, F_TROPISM, tropism_mg[N] * dist_tables.dist[sq][ksq], tropism_eg[N] * dist_tables.dist[sq][ksq]);
 
 	// Knight forwardness
 
@@ -418,7 +445,7 @@ void cEval::ScorePieces(POS *p, eData *e, int sd) {
 
     // Bishop tropism to enemy king
 
-    Add(e, sd, F_TROPISM, tropism_mg[B] * Param.dist[sq][ksq], tropism_eg[B] * Param.dist[sq][ksq]);
+    Add(e, sd, F_TROPISM, tropism_mg[B] * dist_tables.dist[sq][ksq], tropism_eg[B] * dist_tables.dist[sq][ksq]);
 
     // Bishop forwardness
 
@@ -485,7 +512,7 @@ void cEval::ScorePieces(POS *p, eData *e, int sd) {
 
     // Rook tropism to enemy king
 
-    Add(e, sd, F_TROPISM, tropism_mg[R] * Param.dist[sq][ksq], tropism_eg[R] * Param.dist[sq][ksq]);
+    Add(e, sd, F_TROPISM, tropism_mg[R] * dist_tables.dist[sq][ksq], tropism_eg[R] * dist_tables.dist[sq][ksq]);
 
 	// Rook forwardness
 
@@ -573,7 +600,7 @@ void cEval::ScorePieces(POS *p, eData *e, int sd) {
 
     // Queen tropism to enemy king
 
-    Add(e, sd, F_TROPISM, tropism_mg[Q] * Param.dist[sq][ksq], tropism_eg[Q] * Param.dist[sq][ksq]);
+    Add(e, sd, F_TROPISM, tropism_mg[Q] * dist_tables.dist[sq][ksq], tropism_eg[Q] * dist_tables.dist[sq][ksq]);
 
 	// Queen forwardness
 
@@ -721,7 +748,7 @@ void cEval::ScorePassers(POS * p, eData *e, int sd)
       bbStop = BB.ShiftFwd(SqBb(sq), sd);
       mg_tmp = passed_bonus_mg[sd][Rank(sq)];
       eg_tmp = passed_bonus_eg[sd][Rank(sq)] 
-             - ((passed_bonus_eg[sd][Rank(sq)] * Param.dist[sq][p->king_sq[op]]) / 30);
+             - ((passed_bonus_eg[sd][Rank(sq)] * dist_tables.dist[sq][p->king_sq[op]]) / 30);
 
       mul = 100;
 
@@ -759,9 +786,9 @@ void cEval::ScoreUnstoppable(eData *e, POS * p) {
       if (!(Mask.passed[WC][sq] & p->Pawns(BC))) {
         bbSpan = BB.GetFrontSpan(SqBb(sq), WC);
         psq = ((WC - 1) & 56) + (sq & 7);
-        prom_dist = Min(5, Param.chebyshev_dist[sq][psq]);
+        prom_dist = Min(5, dist_tables.chebyshev_dist[sq][psq]);
 
-        if (prom_dist < (Param.chebyshev_dist[ksq][psq] - tempo)) {
+        if (prom_dist < (dist_tables.chebyshev_dist[ksq][psq] - tempo)) {
           if (bbSpan & p->Kings(WC)) prom_dist++;
           w_dist = Min(w_dist, prom_dist);
         }
@@ -781,9 +808,9 @@ void cEval::ScoreUnstoppable(eData *e, POS * p) {
         bbSpan = BB.GetFrontSpan(SqBb(sq), BC);
         if (bbSpan & p->Kings(WC)) tempo -= 1;
         psq = ((BC - 1) & 56) + (sq & 7);
-        prom_dist = Min(5, Param.chebyshev_dist[sq][psq]);
+        prom_dist = Min(5, dist_tables.chebyshev_dist[sq][psq]);
 
-        if (prom_dist < (Param.chebyshev_dist[ksq][psq] - tempo)) {
+        if (prom_dist < (dist_tables.chebyshev_dist[ksq][psq] - tempo)) {
           if (bbSpan & p->Kings(BC)) prom_dist++;
           b_dist = Min(b_dist, prom_dist);
         }
@@ -817,11 +844,16 @@ int cEval::Return(POS *p, eData * e, int use_hash) {
 
   int addr = p->hash_key % EVAL_HASH_SIZE;
 
+  EvalProf(eval_prof.calls[eval_prof.phase]++);
+
   if (EvalTT[addr].key == p->hash_key && use_hash) {
+    EvalProf(eval_prof.hash_hits[eval_prof.phase]++);
     int hashScore = EvalTT[addr].score;
     return p->side == WC ? hashScore : -hashScore;
   }
 
+  ProfStart();
+
   // Clear eval
 
   int score = 0;
@@ -858,19 +890,28 @@ int cEval::Return(POS *p, eData * e, int use_hash) {
 
   Add(e, p->side, F_OTHERS, 10, 5);
 
+  ProfStage(PROF_INIT);
+
   // Evaluate pieces and pawns
 
   ScoreMaterial(p, e, WC);
   ScoreMaterial(p, e, BC);
+  ProfStage(PROF_MATERIAL);
   ScorePieces(p, e, WC);
   ScorePieces(p, e, BC);
+  ProfStage(PROF_PIECES);
   FullPawnEval(p, e, use_hash);
+  ProfStage(PROF_PAWNS);
   ScoreHanging(p, e, WC);
   ScoreHanging(p, e, BC);
+  ProfStage(PROF_HANGING);
   ScorePatterns(p, e);
+  ProfStage(PROF_PATTERNS);
   ScorePassers(p, e, WC);
   ScorePassers(p, e, BC);
+  ProfStage(PROF_PASSERS);
   ScoreUnstoppable(e, p);
+  ProfStage(PROF_UNSTOPPABLE);
 
   // Add asymmetric bonus for keeping certain type of pieces
 
@@ -923,6 +964,15 @@ int cEval::Return(POS *p, eData * e, int use_hash) {
 
   score += CheckmateHelper(p);
 
+  // KPK endgame is scored exactly, using a bitbase: draws get zero,
+  // wins get a bonus so that the search heads for them
+
+  if (p->PawnEndgame() && p->cnt[WC][P] + p->cnt[BC][P] == 1) {
+    int sd = p->cnt[WC][P] ? WC : BC;
+    if (Kpk.Win(p, sd)) score += (sd == WC) ? kpk_win_bonus : -kpk_win_bonus;
+    else                score = 0;
+  }
+
   // Scale down drawish endgames
 
   int draw_factor = 64;
@@ -949,6 +999,7 @@ int cEval::Return(POS *p, eData * e, int use_hash) {
 
   EvalTT[addr].key = p->hash_key;
   EvalTT[addr].score = score;
+  ProfStage(PROF_FINAL);
 
   // Return score relative to the side to move
 
@@ -55,7 +55,10 @@ void cEval::FullPawnEval(POS * p, eData *e, int use_hash) {
 
   int addr = p->pawn_key % PAWN_HASH_SIZE;
 
+  if (use_hash) EvalProf(eval_prof.pawn_probes[eval_prof.phase]++);
+
   if (PawnTT[addr].key == p->pawn_key && use_hash) {
+    EvalProf(eval_prof.pawn_hits[eval_prof.phase]++);
     e->mg[WC][F_PAWNS]   = PawnTT[addr].mg_pawns;
     e->eg[WC][F_PAWNS]   = PawnTT[addr].eg_pawns;
     return;
@@ -20,428 +20,274 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "rodent.h"
 #include <stdio.h>
 
-int *GenerateCaptures(POS *p, int *list) {
-
-  U64 bbPieces, bbMoves, bbEnemy;
-  int from, to;
-  int side = p->side;
-
-  bbEnemy = p->cl_bb[Opp(side)];
-
-  if (side == WC) {
-
-    // White pawn promotions with capture
-
-    bbMoves = ((p->Pawns(WC) & ~FILE_A_BB & RANK_7_BB) << 7) & p->cl_bb[BC];
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (Q_PROM << 12) | (to << 6) | (to - 7);
-      *list++ = (R_PROM << 12) | (to << 6) | (to - 7);
-      *list++ = (B_PROM << 12) | (to << 6) | (to - 7);
-      *list++ = (N_PROM << 12) | (to << 6) | (to - 7);
-    }
-
-  // White pawn promotions with capture
-
-    bbMoves = ((p->Pawns(WC) & ~FILE_H_BB & RANK_7_BB) << 9) & p->cl_bb[BC];
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (Q_PROM << 12) | (to << 6) | (to - 9);
-      *list++ = (R_PROM << 12) | (to << 6) | (to - 9);
-      *list++ = (B_PROM << 12) | (to << 6) | (to - 9);
-      *list++ = (N_PROM << 12) | (to << 6) | (to - 9);
-    }
-
-  // White pawn promotions without capture
-
-    bbMoves = ((p->Pawns(WC) & RANK_7_BB) << 8) & UnoccBb(p);
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (Q_PROM << 12) | (to << 6) | (to - 8);
-      *list++ = (R_PROM << 12) | (to << 6) | (to - 8);
-      *list++ = (B_PROM << 12) | (to << 6) | (to - 8);
-      *list++ = (N_PROM << 12) | (to << 6) | (to - 8);
-    }
-
-  // White pawn captures
-
-    bbMoves = ((p->Pawns(WC) & ~FILE_A_BB & ~RANK_7_BB) << 7) & p->cl_bb[BC];
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | (to - 7);
-    }
-
-  // White pawn captures
-
-    bbMoves = ((p->Pawns(WC) & ~FILE_H_BB & ~RANK_7_BB) << 9) & p->cl_bb[BC];
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | (to - 9);
-    }
-
-  // White en passant capture
-
-    if ((to = p->ep_sq) != NO_SQ) {
-      if (((p->Pawns(WC) & ~FILE_A_BB) << 7) & SqBb(to))
-        *list++ = (EP_CAP << 12) | (to << 6) | (to - 7);
-      if (((p->Pawns(WC) & ~FILE_H_BB) << 9) & SqBb(to))
-        *list++ = (EP_CAP << 12) | (to << 6) | (to - 9);
-    }
-  } else {
+// Move generation is specialized at compile time on side to move and on
+// generation type, so that pawn shifts and castling squares are constants
+// and the color test is done once per call, in the public wrappers.
 
-    // Black pawn promotions with capture
+enum eGenType { GEN_CAPTURES, GEN_QUIET, GEN_CHECKS, GEN_EVASIONS };
 
-    bbMoves = ((p->Pawns(BC) & ~FILE_A_BB & RANK_2_BB) >> 9) & p->cl_bb[WC];
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (Q_PROM << 12) | (to << 6) | (to + 9);
-      *list++ = (R_PROM << 12) | (to << 6) | (to + 9);
-      *list++ = (B_PROM << 12) | (to << 6) | (to + 9);
-      *list++ = (N_PROM << 12) | (to << 6) | (to + 9);
-    }
-
-  // Black pawn promotions with capture
+// Pawn shifts: forward, capture towards file A and capture towards file H
 
-    bbMoves = ((p->Pawns(BC) & ~FILE_H_BB & RANK_2_BB) >> 7) & p->cl_bb[WC];
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (Q_PROM << 12) | (to << 6) | (to + 7);
-      *list++ = (R_PROM << 12) | (to << 6) | (to + 7);
-      *list++ = (B_PROM << 12) | (to << 6) | (to + 7);
-      *list++ = (N_PROM << 12) | (to << 6) | (to + 7);
-    }
-
-  // Black pawn promotions
-
-    bbMoves = ((p->Pawns(BC) & RANK_2_BB) >> 8) & UnoccBb(p);
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (Q_PROM << 12) | (to << 6) | (to + 8);
-      *list++ = (R_PROM << 12) | (to << 6) | (to + 8);
-      *list++ = (B_PROM << 12) | (to << 6) | (to + 8);
-      *list++ = (N_PROM << 12) | (to << 6) | (to + 8);
-    }
+template <int sd> static FORCEINLINE U64 PawnPush(U64 bb) {
+  return (sd == WC) ? bb << 8 : bb >> 8;
+}
 
-  // Black pawn captures, excluding promotions
+template <int sd> static FORCEINLINE U64 PawnCapW(U64 bb) {
+  return (sd == WC) ? (bb & ~FILE_A_BB) << 7 : (bb & ~FILE_A_BB) >> 9;
+}
 
-    bbMoves = ((p->Pawns(BC) & ~FILE_A_BB & ~RANK_2_BB) >> 9) & bbEnemy;
-    while (bbMoves) { 
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | (to + 9);
-    }
+template <int sd> static FORCEINLINE U64 PawnCapE(U64 bb) {
+  return (sd == WC) ? (bb & ~FILE_H_BB) << 9 : (bb & ~FILE_H_BB) >> 7;
+}
 
-  // Black pawn captures, excluding promotions
+static FORCEINLINE int *SerializePawnMoves(int *list, U64 bbMoves, int delta, int flag) {
 
-    bbMoves = ((p->Pawns(BC) & ~FILE_H_BB & ~RANK_2_BB) >> 7) & bbEnemy;
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | (to + 7);
-    }
+  while (bbMoves) {
+    int to = BB.PopFirstBit(&bbMoves);
+    *list++ = (flag << 12) | (to << 6) | (to - delta);
+  }
+  return list;
+}
 
-  // Black en passant capture
+static FORCEINLINE int *SerializePromotions(int *list, U64 bbMoves, int delta) {
 
-    if ((to = p->ep_sq) != NO_SQ) {
-      if (((p->Pawns(BC) & ~FILE_A_BB) >> 9) & SqBb(to))
-        *list++ = (EP_CAP << 12) | (to << 6) | (to + 9);
-      if (((p->Pawns(BC) & ~FILE_H_BB) >> 7) & SqBb(to))
-        *list++ = (EP_CAP << 12) | (to << 6) | (to + 7);
-    }
+  while (bbMoves) {
+    int to = BB.PopFirstBit(&bbMoves);
+    *list++ = (Q_PROM << 12) | (to << 6) | (to - delta);
+    *list++ = (R_PROM << 12) | (to << 6) | (to - delta);
+    *list++ = (B_PROM << 12) | (to << 6) | (to - delta);
+    *list++ = (N_PROM << 12) | (to << 6) | (to - delta);
   }
+  return list;
+}
 
-  // Captures by knight
+template <int pc> static FORCEINLINE U64 PieceAttacks(POS *p, int sq) {
 
-  bbPieces = p->Knights(p->side);
-  while (bbPieces) {
-    from = BB.PopFirstBit(&bbPieces);
-    bbMoves = BB.KnightAttacks(from) & bbEnemy;
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | from;
-    }
-  }
+  if (pc == N) return BB.KnightAttacks(sq);
+  if (pc == B) return BB.BishAttacks(OccBb(p), sq);
+  if (pc == R) return BB.RookAttacks(OccBb(p), sq);
+  if (pc == Q) return BB.QueenAttacks(OccBb(p), sq);
+  return BB.KingAttacks(sq);
+}
 
-  // Captures by bishop
+template <int pc> static FORCEINLINE int *GenPieceMoves(POS *p, int *list, U64 bbPieces, U64 bbTarget) {
 
-  bbPieces = p->Bishops(p->side);
   while (bbPieces) {
-    from = BB.PopFirstBit(&bbPieces);
-    bbMoves = BB.BishAttacks(OccBb(p), from) & bbEnemy;
+    int from = BB.PopFirstBit(&bbPieces);
+    U64 bbMoves = PieceAttacks<pc>(p, from) & bbTarget;
     while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
+      int to = BB.PopFirstBit(&bbMoves);
       *list++ = (to << 6) | from;
     }
   }
+  return list;
+}
 
-  // Captures by rook
+template <int sd> static int *GenCastles(POS *p, int *list) {
 
-  bbPieces = p->Rooks(p->side);
-  while (bbPieces) {
-    from = BB.PopFirstBit(&bbPieces);
-    bbMoves = BB.RookAttacks(OccBb(p), from) & bbEnemy;
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | from;
-    }
-  }
+  const int op = Opp(sd);
+  const int ksq = REL_SQ(E1, sd);
 
-  // Captures by queen
+  // Short castle
 
-  bbPieces = p->Queens(p->side);
-  while (bbPieces) {
-    from = BB.PopFirstBit(&bbPieces);
-    bbMoves = BB.QueenAttacks(OccBb(p), from) & bbEnemy;
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | from;
-    }
-  }
+  if ((p->castle_flags & (sd == WC ? W_KS : B_KS)) && !(OccBb(p) & (RelSqBb(F1, sd) | RelSqBb(G1, sd))))
+    if (!Attacked(p, ksq, op) && !Attacked(p, REL_SQ(F1, sd), op))
+      *list++ = (CASTLE << 12) | (REL_SQ(G1, sd) << 6) | ksq;
 
-  // Captures by king
+  // Long castle
+
+  if ((p->castle_flags & (sd == WC ? W_QS : B_QS)) && !(OccBb(p) & (RelSqBb(B1, sd) | RelSqBb(C1, sd) | RelSqBb(D1, sd))))
+    if (!Attacked(p, ksq, op) && !Attacked(p, REL_SQ(D1, sd), op))
+      *list++ = (CASTLE << 12) | (REL_SQ(C1, sd) << 6) | ksq;
 
-  bbMoves = BB.KingAttacks(KingSq(p, side)) & bbEnemy;
-  while (bbMoves) {
-    to = BB.PopFirstBit(&bbMoves);
-    *list++ = (to << 6) | KingSq(p, side);
-  }
   return list;
 }
 
-int *GenerateQuiet(POS *p, int *list) {
+template <int sd, int type> static int *Generate(POS *p, int *list) {
 
-  U64 bbPieces, bbMoves;
-  int from, to;
-  int side = p->side;
+  const int op = Opp(sd);
+  const int push = (sd == WC) ? 8 : -8;
+  const int cap_w = (sd == WC) ? 7 : -9;
+  const int cap_e = (sd == WC) ? 9 : -7;
+  const U64 bbPromRank = (sd == WC) ? RANK_7_BB : RANK_2_BB;
+  const U64 bbStartRank = (sd == WC) ? RANK_2_BB : RANK_7_BB;
+  U64 bbPawns = p->Pawns(sd);
+  U64 bbEmpty = UnoccBb(p);
+  U64 bbTarget;
 
-  if (side == WC) {
+  if (type == GEN_CAPTURES) {
 
-    // White short castle
+    U64 bbEnemy = p->cl_bb[op];
 
-    if ((p->castle_flags & W_KS) && !(OccBb(p) & (U64)0x0000000000000060))
-      if (!Attacked(p, E1, BC) && !Attacked(p, F1, BC))
-        *list++ = (CASTLE << 12) | (G1 << 6) | E1;
+    // Pawn promotions with capture, then without it
 
-  // White long castle
+    list = SerializePromotions(list, PawnCapW<sd>(bbPawns & bbPromRank) & bbEnemy, cap_w);
+    list = SerializePromotions(list, PawnCapE<sd>(bbPawns & bbPromRank) & bbEnemy, cap_e);
+    list = SerializePromotions(list, PawnPush<sd>(bbPawns & bbPromRank) & bbEmpty, push);
 
-    if ((p->castle_flags & W_QS) && !(OccBb(p) & (U64)0x000000000000000E))
-      if (!Attacked(p, E1, BC) && !Attacked(p, D1, BC))
-        *list++ = (CASTLE << 12) | (C1 << 6) | E1;
+    // Pawn captures, excluding promotions
 
-  // White double pawn moves
+    list = SerializePawnMoves(list, PawnCapW<sd>(bbPawns & ~bbPromRank) & bbEnemy, cap_w, 0);
+    list = SerializePawnMoves(list, PawnCapE<sd>(bbPawns & ~bbPromRank) & bbEnemy, cap_e, 0);
 
-    bbMoves = ((((p->Pawns(WC) & RANK_2_BB) << 8) & UnoccBb(p)) << 8) & UnoccBb(p);
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (EP_SET << 12) | (to << 6) | (to - 16);
+    // En passant captures
+
+    if (p->ep_sq != NO_SQ) {
+      list = SerializePawnMoves(list, PawnCapW<sd>(bbPawns) & SqBb(p->ep_sq), cap_w, EP_CAP);
+      list = SerializePawnMoves(list, PawnCapE<sd>(bbPawns) & SqBb(p->ep_sq), cap_e, EP_CAP);
     }
 
-  // White normal pawn moves
+    bbTarget = bbEnemy;
+  }
 
-    bbMoves = ((p->Pawns(WC) & ~RANK_7_BB) << 8) & UnoccBb(p);
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | (to - 8);
-    }
-  } else {
+  if (type == GEN_QUIET) {
 
-    // Black short castle
+    list = GenCastles<sd>(p, list);
 
-    if ((p->castle_flags & B_KS) && !(OccBb(p) & (U64)0x6000000000000000))
-      if (!Attacked(p, E8, WC) && !Attacked(p, F8, WC))
-        *list++ = (CASTLE << 12) | (G8 << 6) | E8;
+    // Double pawn moves, then single pawn moves excluding promotions
 
-    // Black long castle
+    list = SerializePawnMoves(list, PawnPush<sd>(PawnPush<sd>(bbPawns & bbStartRank) & bbEmpty) & bbEmpty, 2 * push, EP_SET);
+    list = SerializePawnMoves(list, PawnPush<sd>(bbPawns & ~bbPromRank) & bbEmpty, push, 0);
 
-    if ((p->castle_flags & B_QS) && !(OccBb(p) & (U64)0x0E00000000000000))
-      if (!Attacked(p, E8, WC) && !Attacked(p, D8, WC))
-        *list++ = (CASTLE << 12) | (C8 << 6) | E8;
+    bbTarget = bbEmpty;
+  }
 
-    // Black double pawn moves
+  if (type == GEN_EVASIONS) {
 
-    bbMoves = ((((p->Pawns(BC) & RANK_7_BB) >> 8) & UnoccBb(p)) >> 8) & UnoccBb(p);
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (EP_SET << 12) | (to << 6) | (to + 16);
-    }
+    int ksq = KingSq(p, sd);
+    U64 bbCheckers = AttacksTo(p, ksq) & p->cl_bb[op];
+    U64 bbSliders = bbCheckers & (p->DiagMovers(op) | p->StraightMovers(op));
+    U64 bbRays = 0;
 
-    // Black single pawn moves
+    // King moves, excluding squares on the line of a checking slider
+    // (they stay attacked once the king steps away from the checker)
 
-    bbMoves = ((p->Pawns(BC) & ~RANK_2_BB) >> 8) & UnoccBb(p);
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | (to + 8);
+    while (bbSliders) {
+      int csq = BB.PopFirstBit(&bbSliders);
+      if (SqBb(csq) & p->StraightMovers(op))
+        bbRays |= BB.RookAttacks(OccBb(p) ^ SqBb(ksq), csq);
+      if (SqBb(csq) & p->DiagMovers(op))
+        bbRays |= BB.BishAttacks(OccBb(p) ^ SqBb(ksq), csq);
     }
-  }
+    list = GenPieceMoves<K>(p, list, SqBb(ksq), ~p->cl_bb[sd] & ~bbRays);
 
-  // Knight moves
+    // Double check can be met only by a king move
 
-  bbPieces = p->Knights(p->side);
-  while (bbPieces) {
-    from = BB.PopFirstBit(&bbPieces);
-    bbMoves = BB.KnightAttacks(from) & UnoccBb(p);
-  while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | from;
-    }
-  }
+    if (BB.PopCnt(bbCheckers) > 1) return list;
 
-  // Bishop moves
+    // Capture the checker or interpose
 
-  bbPieces = p->Bishops(p->side);
-  while (bbPieces) {
-    from = BB.PopFirstBit(&bbPieces);
-    bbMoves = BB.BishAttacks(OccBb(p), from) & UnoccBb(p);
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | from;
-    }
-  }
+    U64 bbBlock = BB.Between(FirstOne(bbCheckers), ksq);
 
-  // Rook moves
+    list = SerializePromotions(list, PawnCapW<sd>(bbPawns & bbPromRank) & bbCheckers, cap_w);
+    list = SerializePromotions(list, PawnCapE<sd>(bbPawns & bbPromRank) & bbCheckers, cap_e);
+    list = SerializePromotions(list, PawnPush<sd>(bbPawns & bbPromRank) & bbBlock, push);
+    list = SerializePawnMoves(list, PawnCapW<sd>(bbPawns & ~bbPromRank) & bbCheckers, cap_w, 0);
+    list = SerializePawnMoves(list, PawnCapE<sd>(bbPawns & ~bbPromRank) & bbCheckers, cap_e, 0);
 
-  bbPieces = p->Rooks(p->side);
-  while (bbPieces) {
-    from = BB.PopFirstBit(&bbPieces);
-    bbMoves = BB.RookAttacks(OccBb(p), from) & UnoccBb(p);
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | from;
+    // En passant captures a checking pawn or blocks on its target square
+
+    if (p->ep_sq != NO_SQ
+    && ((SqBb(p->ep_sq ^ 8) & bbCheckers) || (SqBb(p->ep_sq) & bbBlock))) {
+      list = SerializePawnMoves(list, PawnCapW<sd>(bbPawns) & SqBb(p->ep_sq), cap_w, EP_CAP);
+      list = SerializePawnMoves(list, PawnCapE<sd>(bbPawns) & SqBb(p->ep_sq), cap_e, EP_CAP);
     }
-  }
 
-  // Queen moves
+    list = SerializePawnMoves(list, PawnPush<sd>(PawnPush<sd>(bbPawns & bbStartRank) & bbEmpty) & bbBlock, 2 * push, EP_SET);
+    list = SerializePawnMoves(list, PawnPush<sd>(bbPawns & ~bbPromRank) & bbBlock, push, 0);
 
-  bbPieces = p->Queens(p->side);
-  while (bbPieces) {
-    from = BB.PopFirstBit(&bbPieces);
-    bbMoves = BB.QueenAttacks(OccBb(p), from) & UnoccBb(p);
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | from;
-    }
+    bbTarget = bbCheckers | bbBlock;
+    list = GenPieceMoves<N>(p, list, p->Knights(sd), bbTarget);
+    list = GenPieceMoves<B>(p, list, p->Bishops(sd), bbTarget);
+    list = GenPieceMoves<R>(p, list, p->Rooks(sd), bbTarget);
+    list = GenPieceMoves<Q>(p, list, p->Queens(sd), bbTarget);
+    return list;
   }
 
-  // King moves
+  if (type == GEN_CHECKS) {
 
-  bbMoves = BB.KingAttacks(KingSq(p, side)) & UnoccBb(p);
-  while (bbMoves) {
-    to = BB.PopFirstBit(&bbMoves);
-    *list++ = (to << 6) | KingSq(p, side);
-  }
+    int ksq = KingSq(p, op);
+    U64 bbKnightChk = BB.KnightAttacks(ksq);
+    U64 bbStr8Chk = BB.RookAttacks(OccBb(p), ksq);
+    U64 bbDiagChk = BB.BishAttacks(OccBb(p), ksq);
+    U64 bbQueenChk = bbStr8Chk | bbDiagChk;
+    U64 bbPawnChk = BB.ShiftFwd(BB.ShiftSideways(SqBb(ksq)), op);
 
-  return list;
-}
+    // Pawn checks by a double move, then by a single move
 
-int *GenerateQuietChecks(POS *p, int *list)
-{
-  U64 bbPieces, bbMoves;
-  int ksq = KingSq(p, Opp(p->side));
-  U64 bbKnightChk = BB.KnightAttacks(ksq);
-  U64 bbStr8Chk = BB.RookAttacks(OccBb(p), ksq);
-  U64 bbDiagChk = BB.BishAttacks(OccBb(p), ksq);
-  U64 bbQueenChk = bbStr8Chk | bbDiagChk;
-  U64 bbPawnChk = BB.ShiftFwd( BB.ShiftSideways(SqBb(ksq)), Opp(p->side));
+    list = SerializePawnMoves(list, PawnPush<sd>(PawnPush<sd>(bbPawns & bbStartRank) & bbEmpty) & bbEmpty & bbPawnChk, 2 * push, EP_SET);
+    list = SerializePawnMoves(list, PawnPush<sd>(bbPawns & ~bbPromRank) & bbEmpty & bbPawnChk, push, 0);
 
-  int side, from, to;
+    // Knight checks, including moves that discover a check
 
-  side = p->side;
-  int op = Opp(side);
+    U64 bbPieces = p->Knights(sd);
+    while (bbPieces) {
+      int from = BB.PopFirstBit(&bbPieces);
+      int knight_discovers = 0;
 
-  if (side == WC) {
+      U64 bbCheckers = p->Queens(op) | p->Rooks(op) | p->Bishops(op);
+      while (bbCheckers) {
+        int checker = BB.PopFirstBit(&bbCheckers);
+        U64 bbRay = BB.Between(checker, ksq);
 
-    // White pawn checks by a double move
+        if (SqBb(from) & bbRay) {
+          if (BB.PopCnt(bbRay & OccBb(p)) == 1) {
+            knight_discovers = 1;
+            break;
+          }
+        }
+      }
 
-    bbMoves = ((((p->Pawns(WC) & RANK_2_BB) << 8) & UnoccBb(p)) << 8) & UnoccBb(p);
-    bbMoves &= bbPawnChk;
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (EP_SET << 12) | (to << 6) | (to - 16);
+      U64 bbMoves = BB.KnightAttacks(from) & bbEmpty;
+      if (!knight_discovers) bbMoves &= bbKnightChk;
+      while (bbMoves) {
+        int to = BB.PopFirstBit(&bbMoves);
+        *list++ = (to << 6) | from;
+      }
     }
 
-    // White pawn checks by a single move
+    list = GenPieceMoves<B>(p, list, p->Bishops(sd), bbEmpty & bbDiagChk);
+    list = GenPieceMoves<R>(p, list, p->Rooks(sd), bbEmpty & bbStr8Chk);
+    list = GenPieceMoves<Q>(p, list, p->Queens(sd), bbEmpty & bbQueenChk);
+    return list;
+  }
 
-    bbMoves = ((p->Pawns(WC) & ~RANK_7_BB) << 8) & UnoccBb(p);
-    bbMoves &= bbPawnChk;
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | (to - 8);
-    }
+  // Piece moves
 
-  } else {
+  list = GenPieceMoves<N>(p, list, p->Knights(sd), bbTarget);
+  list = GenPieceMoves<B>(p, list, p->Bishops(sd), bbTarget);
+  list = GenPieceMoves<R>(p, list, p->Rooks(sd), bbTarget);
+  list = GenPieceMoves<Q>(p, list, p->Queens(sd), bbTarget);
+  list = GenPieceMoves<K>(p, list, p->Kings(sd), bbTarget);
+  return list;
+}
 
-    // Black pawn checks by a double move
+int *GenerateCaptures(POS *p, int *list) {
+  return (p->side == WC) ? Generate<WC, GEN_CAPTURES>(p, list) : Generate<BC, GEN_CAPTURES>(p, list);
+}
 
-    bbMoves = ((((p->Pawns(BC) & RANK_7_BB) >> 8) & UnoccBb(p)) >> 8) & UnoccBb(p);
-    bbMoves &= bbPawnChk;
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (EP_SET << 12) | (to << 6) | (to + 16);
-    }
+int *GenerateQuiet(POS *p, int *list) {
+  return (p->side == WC) ? Generate<WC, GEN_QUIET>(p, list) : Generate<BC, GEN_QUIET>(p, list);
+}
 
-    // Black pawn checks by a single move
+int *GenerateQuietChecks(POS *p, int *list) {
+  return (p->side == WC) ? Generate<WC, GEN_CHECKS>(p, list) : Generate<BC, GEN_CHECKS>(p, list);
+}
 
-    bbMoves = ((p->Pawns(BC) & ~RANK_2_BB) >> 8) & UnoccBb(p);
-    bbMoves &= bbPawnChk;
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | (to + 8);
-    }
-  }
+int *GenerateEvasions(POS *p, int *list) {
+  return (p->side == WC) ? Generate<WC, GEN_EVASIONS>(p, list) : Generate<BC, GEN_EVASIONS>(p, list);
+}
 
-  bbPieces = p->Knights(side);
-  while (bbPieces) {
-    from = BB.PopFirstBit(&bbPieces);
-	int knight_discovers = 0;
-
-	U64 bbCheckers = p->Queens(op) | p->Rooks(op) | p->Bishops(op);
-	while (bbCheckers) {
-		int checker = BB.PopFirstBit(&bbCheckers);
-		U64 bbRay = BB.bbBetween[checker][p->king_sq[op]];
-
-		if (SqBb(from) & bbRay) {
-			if (BB.PopCnt(bbRay & OccBb(p)) == 1) {
-				knight_discovers = 1;
-				break;
-			}
-		}
-	}
-
-	bbMoves = (BB.KnightAttacks(from) & UnoccBb(p));
-	if (!knight_discovers) bbMoves &= bbKnightChk;
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | from;
-    }
-  }
+// @GenerateLegal() returns all legal moves (used by perft)
 
-  bbPieces = p->Bishops(side);
-  while (bbPieces) {
-    from = BB.PopFirstBit(&bbPieces);
-    bbMoves = (BB.BishAttacks(OccBb(p), from) & UnoccBb(p)) & bbDiagChk;
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | from;
-    }
-  }
+int *GenerateLegal(POS *p, int *list) {
 
-  bbPieces = p->Rooks(side);
-  while (bbPieces) {
-    from = BB.PopFirstBit(&bbPieces);
-    bbMoves = (BB.RookAttacks(OccBb(p), from) & UnoccBb(p)) & bbStr8Chk;
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | from;
-    }
-  }
+  CHECK_INFO ci[1];
+  int *last;
 
-  bbPieces = p->Queens(side);
-  while (bbPieces) {
-    from = BB.PopFirstBit(&bbPieces);
-    bbMoves = (BB.QueenAttacks(OccBb(p), from) & UnoccBb(p)) & bbQueenChk;
-    while (bbMoves) {
-      to = BB.PopFirstBit(&bbMoves);
-      *list++ = (to << 6) | from;
-    }
-  }
+  InitCheckInfo(p, ci);
+  if (ci->bbCheckers) last = GenerateEvasions(p, list);
+  else                last = GenerateQuiet(p, GenerateCaptures(p, list));
 
-  return list;
-}
\ No newline at end of file
+  return FilterLegal(p, list, last, ci);
+}
@@ -19,25 +19,32 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "rodent.h"
 
-void Init(void) {
+// Zobrist keys are generated at compile time, so that they are placed in
+// read-only data shared by all engine processes. The sequence of pseudo-
+// random numbers is the same as the one formerly drawn at startup.
 
-  for (int sq = 0; sq < 64; sq++)
-    castle_mask[sq] = 15;
+static constexpr ZOBRIST InitZobrist(void) {
 
-  castle_mask[A1] = 13;
-  castle_mask[E1] = 12;
-  castle_mask[H1] = 14;
-  castle_mask[A8] = 7;
-  castle_mask[E8] = 3;
-  castle_mask[H8] = 11;
+  ZOBRIST z{};
+  U64 next = 1;
 
   for (int tp = 0; tp < 12; tp++)
-    for (int sq = 0; sq < 64; sq++)
-      zob_piece[tp][sq] = Random64();
-
-  for (int i = 0; i < 16; i++)
-    zob_castle[i] = Random64();
-
-  for (int i = 0; i < 8; i++)
-    zob_ep[i] = Random64();
+    for (int sq = 0; sq < 64; sq++) {
+      next = next * 1103515245 + 12345;
+      z.piece[tp][sq] = next;
+    }
+
+  for (int i = 0; i < 16; i++) {
+    next = next * 1103515245 + 12345;
+    z.castle[i] = next;
+  }
+
+  for (int i = 0; i < 8; i++) {
+    next = next * 1103515245 + 12345;
+    z.ep[i] = next;
+  }
+
+  return z;
 }
+
+constexpr ZOBRIST Zob = InitZobrist();
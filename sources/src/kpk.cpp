@@ -0,0 +1,307 @@
+/*
+Rodent, a UCI chess playing engine derived from Sungorus 1.4
+Copyright (C) 2009-2011 Pablo Vazquez (Sungorus author)
+Copyright (C) 2011-2016 Pawel Koziol
+
+Rodent is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published
+by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+Rodent is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// KPK bitbase, generated by retrograde analysis when the engine starts.
+// Positions are stored from the point of view of the side with a pawn
+// ("white"), with the pawn on files A-D, so that the table fits in 24 KB.
+// The algorithm follows the one of Stockfish. Generation takes too long
+// for a constant expression, and it must not happen inside a timed search.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "rodent.h"
+
+enum { KPK_INVALID = 0, KPK_UNKNOWN = 1, KPK_DRAW = 2, KPK_WIN = 4 };
+
+// Note that BB.KingAttacks() includes the square of a king itself
+
+static U64 KingMoves(int sq) {
+  return BB.KingAttacks(sq) & ~SqBb(sq);
+}
+
+static int KpkIndex(int stm, int bksq, int wksq, int psq) {
+  return stm | (bksq << 1) | (wksq << 7) | (File(psq) << 13) | ((RANK_7 - Rank(psq)) << 15);
+}
+
+static int KpkInitial(int idx) {
+
+  int stm  = idx & 1;
+  int bksq = (idx >> 1) & 63;
+  int wksq = (idx >> 7) & 63;
+  int psq  = Sq((idx >> 13) & 3, RANK_7 - ((idx >> 15) & 7));
+
+  // Overlapping pieces, adjacent kings or side not to move in check
+
+  if (wksq == bksq
+  || (KingMoves(wksq) & SqBb(bksq))
+  || wksq == psq
+  || bksq == psq
+  || (stm == WC && (BB.PawnAttacks(WC, psq) & SqBb(bksq))))
+    return KPK_INVALID;
+
+  // Pawn promotes without being captured
+
+  if (stm == WC
+  && Rank(psq) == RANK_7
+  && wksq != psq + 8
+  && bksq != psq + 8
+  && (!(KingMoves(bksq) & SqBb(psq + 8)) || (KingMoves(wksq) & SqBb(psq + 8))))
+    return KPK_WIN;
+
+  // Stalemate or undefended pawn captured
+
+  if (stm == BC) {
+    if (!(KingMoves(bksq) & ~(KingMoves(wksq) | BB.PawnAttacks(WC, psq))))
+      return KPK_DRAW;
+
+    if (KingMoves(bksq) & SqBb(psq) & ~KingMoves(wksq))
+      return KPK_DRAW;
+  }
+
+  return KPK_UNKNOWN;
+}
+
+static int KpkClassify(unsigned char *db, int idx) {
+
+  int stm  = idx & 1;
+  int bksq = (idx >> 1) & 63;
+  int wksq = (idx >> 7) & 63;
+  int psq  = Sq((idx >> 13) & 3, RANK_7 - ((idx >> 15) & 7));
+  int r = KPK_INVALID;
+  U64 bbMoves;
+
+  // Moves to invalid positions (i.e. illegal ones) add nothing to the result
+
+  if (stm == WC) {
+    bbMoves = KingMoves(wksq);
+    while (bbMoves)
+      r |= db[KpkIndex(BC, bksq, BB.PopFirstBit(&bbMoves), psq)];
+
+    if (Rank(psq) < RANK_7)
+      r |= db[KpkIndex(BC, bksq, wksq, psq + 8)];
+
+    if (Rank(psq) == RANK_2 && psq + 8 != wksq && psq + 8 != bksq)
+      r |= db[KpkIndex(BC, bksq, wksq, psq + 16)];
+
+    return (r & KPK_WIN) ? KPK_WIN : (r & KPK_UNKNOWN) ? KPK_UNKNOWN : KPK_DRAW;
+  }
+
+  bbMoves = KingMoves(bksq);
+  while (bbMoves)
+    r |= db[KpkIndex(WC, BB.PopFirstBit(&bbMoves), wksq, psq)];
+
+  return (r & KPK_DRAW) ? KPK_DRAW : (r & KPK_UNKNOWN) ? KPK_UNKNOWN : KPK_WIN;
+}
+
+void cKpk::Init(void) {
+
+  unsigned char *db = (unsigned char *) malloc(KPK_SIZE);
+  int changed;
+
+  for (int idx = 0; idx < KPK_SIZE; idx++)
+    db[idx] = KpkInitial(idx);
+
+  // Resolve unknown positions until nothing changes
+
+  do {
+    changed = 0;
+    for (int idx = 0; idx < KPK_SIZE; idx++) {
+      if (db[idx] == KPK_UNKNOWN) {
+        db[idx] = KpkClassify(db, idx);
+        if (db[idx] != KPK_UNKNOWN) changed = 1;
+      }
+    }
+  } while (changed);
+
+  // Unresolved positions are draws, so only wins are stored
+
+  for (int i = 0; i < KPK_SIZE / 32; i++)
+    bits[i] = 0;
+
+  for (int idx = 0; idx < KPK_SIZE; idx++)
+    if (db[idx] == KPK_WIN)
+      bits[idx >> 5] |= 1u << (idx & 31);
+
+  free(db);
+}
+
+int cKpk::Probe(int wksq, int wpsq, int bksq, int stm) {
+
+  int idx = KpkIndex(stm, bksq, wksq, wpsq);
+  return (bits[idx >> 5] >> (idx & 31)) & 1;
+}
+
+int cKpk::Win(POS *p, int sd) {
+
+  // Normalize the position, so that pawn is white and stands on files A-D
+
+  int wksq = KingSq(p, sd);
+  int bksq = KingSq(p, Opp(sd));
+  int psq = FirstOne(p->Pawns(sd));
+  int stm = (p->side == sd) ? WC : BC;
+
+  if (sd == BC) {
+    wksq ^= 56;
+    bksq ^= 56;
+    psq ^= 56;
+  }
+
+  if (File(psq) > FILE_D) {
+    wksq ^= 7;
+    bksq ^= 7;
+    psq ^= 7;
+  }
+
+  return Probe(wksq, psq, bksq, stm);
+}
+
+// @Verify() checks the bitbase against exhaustive search using the regular
+// move generator of the engine. Each legal KPK position is linked to its
+// successors, then the game graph is solved by iterating to a fixed point.
+// Returns the number of mismatches.
+
+int cKpk::Verify(void) {
+
+  POS p[1];
+  UNDO u[1];
+  char fen[100];
+  int list[MAX_MOVES], *last;
+  int *first_child = (int *) malloc((KPK_SIZE + 1) * sizeof(int));
+  int *child = (int *) malloc(KPK_SIZE * 12 * sizeof(int));
+  unsigned char *val = (unsigned char *) malloc(KPK_SIZE);
+  int n_child = 0, n_legal = 0, n_wins = 0, errors = 0, changed;
+
+  for (int idx = 0; idx < KPK_SIZE; idx++) {
+
+    int stm  = idx & 1;
+    int bksq = (idx >> 1) & 63;
+    int wksq = (idx >> 7) & 63;
+    int psq  = Sq((idx >> 13) & 3, RANK_7 - ((idx >> 15) & 7));
+
+    first_child[idx] = n_child;
+    val[idx] = KPK_INVALID;
+
+    if (wksq == bksq || wksq == psq || bksq == psq) continue;
+
+    // Set up the position on the board
+
+    char *ptr = fen;
+    for (int rank = RANK_8; rank >= RANK_1; rank--) {
+      int empty = 0;
+      for (int file = FILE_A; file <= FILE_H; file++) {
+        int sq = Sq(file, rank);
+        char c = (sq == wksq) ? 'K' : (sq == bksq) ? 'k' : (sq == psq) ? 'P' : 0;
+        if (!c) { empty++; continue; }
+        if (empty) { *ptr++ = '0' + empty; empty = 0; }
+        *ptr++ = c;
+      }
+      if (empty) *ptr++ = '0' + empty;
+      if (rank > RANK_1) *ptr++ = '/';
+    }
+    sprintf(ptr, " %c - -", stm == WC ? 'w' : 'b');
+    SetPosition(p, fen);
+
+    if ((KingMoves(wksq) & SqBb(bksq)) || Illegal(p)) continue;
+
+    // Link the position to the results of all legal moves. Positions
+    // where KPK is left are scored here: capture of a pawn is a draw,
+    // promotion wins unless new piece is captured or it is a stalemate.
+
+    n_legal++;
+    val[idx] = KPK_UNKNOWN;
+    last = GenerateCaptures(p, list);
+    last = GenerateQuiet(p, last);
+
+    for (int *movep = list; movep < last; movep++) {
+      p->DoMove(*movep, u);
+      if (Illegal(p)) { p->UndoMove(*movep, u); continue; }
+
+      if (p->cnt[WC][P] == 1) {
+        child[n_child++] = KpkIndex(p->side, KingSq(p, BC), KingSq(p, WC), FirstOne(p->Pawns(WC)));
+      } else if (p->cnt[WC][Q] + p->cnt[WC][R] == 0) {
+        child[n_child++] = -KPK_DRAW;
+      } else {
+        int has_move = 0, captured = 0, reply[MAX_MOVES], *reply_last;
+        UNDO u2[1];
+        reply_last = GenerateCaptures(p, reply);
+        reply_last = GenerateQuiet(p, reply_last);
+        for (int *r = reply; r < reply_last; r++) {
+          p->DoMove(*r, u2);
+          if (!Illegal(p)) {
+            has_move = 1;
+            if (p->cnt[WC][Q] + p->cnt[WC][R] == 0) captured = 1;
+          }
+          p->UndoMove(*r, u2);
+        }
+        if (captured || (!has_move && !InCheck(p))) child[n_child++] = -KPK_DRAW;
+        else                                         child[n_child++] = -KPK_WIN;
+      }
+      p->UndoMove(*movep, u);
+    }
+
+    // Side to move has no legal moves: checkmate or stalemate
+
+    if (n_child == first_child[idx])
+      val[idx] = (stm == BC && InCheck(p)) ? KPK_WIN : KPK_DRAW;
+  }
+  first_child[KPK_SIZE] = n_child;
+
+  // Solve the game graph
+
+  do {
+    changed = 0;
+    for (int idx = 0; idx < KPK_SIZE; idx++) {
+      if (val[idx] != KPK_UNKNOWN) continue;
+
+      int r = 0;
+      for (int c = first_child[idx]; c < first_child[idx + 1]; c++)
+        r |= (child[c] < 0) ? -child[c] : val[child[c]];
+
+      if (idx & 1) r = (r & KPK_DRAW) ? KPK_DRAW : (r & KPK_UNKNOWN) ? KPK_UNKNOWN : KPK_WIN;
+      else         r = (r & KPK_WIN)  ? KPK_WIN  : (r & KPK_UNKNOWN) ? KPK_UNKNOWN : KPK_DRAW;
+
+      if (r != KPK_UNKNOWN) {
+        val[idx] = r;
+        changed = 1;
+      }
+    }
+  } while (changed);
+
+  // Compare results
+
+  for (int idx = 0; idx < KPK_SIZE; idx++) {
+    if (val[idx] == KPK_INVALID) continue;
+
+    int win = (val[idx] == KPK_WIN);
+    int psq = Sq((idx >> 13) & 3, RANK_7 - ((idx >> 15) & 7));
+    n_wins += win;
+
+    if (win != Probe((idx >> 7) & 63, psq, (idx >> 1) & 63, idx & 1)) {
+      if (errors < 10) printf("info string kpk mismatch at index %d\n", idx);
+      errors++;
+    }
+  }
+
+  printf("info string kpk: %d legal positions, %d wins, %d mismatches\n", n_legal, n_wins, errors);
+
+  free(first_child);
+  free(child);
+  free(val);
+  return errors;
+}
@@ -118,3 +118,102 @@ int Legal(POS *p, int move) {
 
   return (AttacksFrom(p, fsq) & SqBb(tsq)) != 0;
 }
+
+// @InitCheckInfo() finds pieces pinned to the king of side to move
+// and the squares where a non-king move must go to resolve a check.
+
+void InitCheckInfo(POS *p, CHECK_INFO *ci) {
+
+  int sd = p->side;
+  int op = Opp(sd);
+  int ksq = KingSq(p, sd);
+  U64 bbPinners, bbBlockers;
+
+  ci->bbCheckers = AttacksTo(p, ksq) & p->cl_bb[op];
+  ci->bbPinned = 0;
+
+  bbPinners = (BB.RookAttacks(0, ksq) & p->StraightMovers(op))
+            | (BB.BishAttacks(0, ksq) & p->DiagMovers(op));
+
+  while (bbPinners) {
+    bbBlockers = BB.Between(BB.PopFirstBit(&bbPinners), ksq) & OccBb(p);
+    if (BB.PopCnt(bbBlockers) == 1)
+      ci->bbPinned |= bbBlockers & p->cl_bb[sd];
+  }
+
+  // In check, non-king moves must capture the checker or interpose.
+  // Double check leaves only king moves.
+
+  if (!ci->bbCheckers)
+    ci->bbTarget = ~(U64)0;
+  else if (BB.PopCnt(ci->bbCheckers) == 1)
+    ci->bbTarget = ci->bbCheckers | BB.Between(FirstOne(ci->bbCheckers), ksq);
+  else
+    ci->bbTarget = 0;
+}
+
+// Is square attacked by side sd, given occupancy bbOcc
+// (used to see through a king moving away from a slider)
+
+static int AttackedWithOcc(POS *p, int sq, int sd, U64 bbOcc) {
+
+  return (p->Pawns(sd) & BB.PawnAttacks(Opp(sd), sq)) ||
+         (p->Knights(sd) & BB.KnightAttacks(sq)) ||
+         (p->DiagMovers(sd) & BB.BishAttacks(bbOcc, sq)) ||
+         (p->StraightMovers(sd) & BB.RookAttacks(bbOcc, sq)) ||
+         (p->Kings(sd) & BB.KingAttacks(sq));
+}
+
+// @KeepsKingSafe() tells whether a pseudo-legal move leaves own king
+// out of check, without making it on the board.
+
+int KeepsKingSafe(POS *p, int move, CHECK_INFO *ci) {
+
+  int sd = p->side;
+  int op = Opp(sd);
+  int fsq = Fsq(move);
+  int tsq = Tsq(move);
+  int ksq = KingSq(p, sd);
+
+  // King moves: castling has been checked except for the target square
+
+  if (fsq == ksq) {
+    if (MoveType(move) == CASTLE) return !Attacked(p, tsq, op);
+    return !AttackedWithOcc(p, tsq, op, OccBb(p) ^ SqBb(fsq));
+  }
+
+  // En passant removes two pieces from a line, so we test it directly
+
+  if (MoveType(move) == EP_CAP) {
+    int csq = tsq ^ 8;
+    U64 bbOcc = OccBb(p) ^ SqBb(fsq) ^ SqBb(tsq) ^ SqBb(csq);
+    return !((p->DiagMovers(op) & BB.BishAttacks(bbOcc, ksq))
+          || (p->StraightMovers(op) & BB.RookAttacks(bbOcc, ksq))
+          || (p->Knights(op) & BB.KnightAttacks(ksq))
+          || (p->Pawns(op) & ~SqBb(csq) & BB.PawnAttacks(sd, ksq)));
+  }
+
+  // Other moves must resolve a check, and pinned pieces
+  // may move only along the line connecting them with the king
+
+  if (!(SqBb(tsq) & ci->bbTarget)) return 0;
+
+  if (SqBb(fsq) & ci->bbPinned)
+    return ((BB.Between(ksq, tsq) & SqBb(fsq)) || (BB.Between(ksq, fsq) & SqBb(tsq)));
+
+  return 1;
+}
+
+// @FilterLegal() removes moves leaving own king in check from a generated
+// list, preserving the order of the remaining ones. Returns the new end.
+
+int *FilterLegal(POS *p, int *list, int *last, CHECK_INFO *ci) {
+
+  int *out = list;
+
+  for (int *movep = list; movep < last; movep++)
+    if (KeepsKingSafe(p, *movep, ci))
+      *out++ = *movep;
+
+  return out;
+}
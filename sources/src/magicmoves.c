@@ -36,7 +36,7 @@
   #pragma warning( disable : 4146)
 #endif
 
-const unsigned int magicmoves_r_shift[64]=
+constexpr unsigned int magicmoves_r_shift[64]=
 {
   52, 53, 53, 53, 53, 53, 53, 52,
   53, 54, 54, 54, 54, 54, 54, 53,
@@ -48,7 +48,7 @@ const unsigned int magicmoves_r_shift[64]=
   53, 54, 54, 53, 53, 53, 53, 53
 };
 
-const U64 magicmoves_r_magics[64]=
+constexpr U64 magicmoves_r_magics[64]=
 {
   C64(0x0080001020400080), C64(0x0040001000200040), C64(0x0080081000200080), C64(0x0080040800100080),
   C64(0x0080020400080080), C64(0x0080010200040080), C64(0x0080008001000200), C64(0x0080002040800100),
@@ -67,7 +67,7 @@ const U64 magicmoves_r_magics[64]=
   C64(0x00FFFCDDFCED714A), C64(0x007FFCDDFCED714A), C64(0x003FFFCDFFD88096), C64(0x0000040810002101),
   C64(0x0001000204080011), C64(0x0001000204000801), C64(0x0001000082000401), C64(0x0001FFFAABFAD1A2)
 };
-const U64 magicmoves_r_mask[64]=
+constexpr U64 magicmoves_r_mask[64]=
 {  
   C64(0x000101010101017E), C64(0x000202020202027C), C64(0x000404040404047A), C64(0x0008080808080876),
   C64(0x001010101010106E), C64(0x002020202020205E), C64(0x004040404040403E), C64(0x008080808080807E),
@@ -87,7 +87,7 @@ const U64 magicmoves_r_mask[64]=
   C64(0x6E10101010101000), C64(0x5E20202020202000), C64(0x3E40404040404000), C64(0x7E80808080808000)
 };
 
-const unsigned int magicmoves_b_shift[64]=
+constexpr unsigned int magicmoves_b_shift[64]=
 {
   58, 59, 59, 59, 59, 59, 59, 58,
   59, 59, 59, 59, 59, 59, 59, 59,
@@ -99,7 +99,7 @@ const unsigned int magicmoves_b_shift[64]=
   58, 59, 59, 59, 59, 59, 59, 58
 };
 
-const U64 magicmoves_b_magics[64]=
+constexpr U64 magicmoves_b_magics[64]=
 {
   C64(0x0002020202020200), C64(0x0002020202020000), C64(0x0004010202000000), C64(0x0004040080000000),
   C64(0x0001104000000000), C64(0x0000821040000000), C64(0x0000410410400000), C64(0x0000104104104000),
@@ -119,7 +119,7 @@ const U64 magicmoves_b_magics[64]=
   C64(0x0000000010020200), C64(0x0000000404080200), C64(0x0000040404040400), C64(0x0002020202020200)
 };
 
-const U64 magicmoves_b_mask[64]=
+constexpr U64 magicmoves_b_mask[64]=
 {
   C64(0x0040201008040200), C64(0x0000402010080400), C64(0x0000004020100A00), C64(0x0000000040221400),
   C64(0x0000000002442800), C64(0x0000000204085000), C64(0x0000020408102000), C64(0x0002040810204000),
@@ -139,61 +139,11 @@ const U64 magicmoves_b_mask[64]=
   C64(0x0028440200000000), C64(0x0050080402000000), C64(0x0020100804020000), C64(0x0040201008040200)
 };
 
-U64 magicmovesbdb[5248];
-const U64* magicmoves_b_indices[64]=
-{
-  magicmovesbdb+4992, magicmovesbdb+2624,  magicmovesbdb+256,  magicmovesbdb+896,
-  magicmovesbdb+1280, magicmovesbdb+1664, magicmovesbdb+4800, magicmovesbdb+5120,
-  magicmovesbdb+2560, magicmovesbdb+2656,  magicmovesbdb+288,  magicmovesbdb+928,
-  magicmovesbdb+1312, magicmovesbdb+1696, magicmovesbdb+4832, magicmovesbdb+4928,
-  magicmovesbdb+0,     magicmovesbdb+128,  magicmovesbdb+320,  magicmovesbdb+960,
-  magicmovesbdb+1344, magicmovesbdb+1728, magicmovesbdb+2304, magicmovesbdb+2432,
-  magicmovesbdb+32,    magicmovesbdb+160,  magicmovesbdb+448, magicmovesbdb+2752,
-  magicmovesbdb+3776, magicmovesbdb+1856, magicmovesbdb+2336, magicmovesbdb+2464,
-  magicmovesbdb+64,    magicmovesbdb+192,  magicmovesbdb+576, magicmovesbdb+3264,
-  magicmovesbdb+4288, magicmovesbdb+1984, magicmovesbdb+2368, magicmovesbdb+2496,
-  magicmovesbdb+96,    magicmovesbdb+224,  magicmovesbdb+704, magicmovesbdb+1088,
-  magicmovesbdb+1472, magicmovesbdb+2112, magicmovesbdb+2400, magicmovesbdb+2528,
-  magicmovesbdb+2592, magicmovesbdb+2688,  magicmovesbdb+832, magicmovesbdb+1216,
-  magicmovesbdb+1600, magicmovesbdb+2240, magicmovesbdb+4864, magicmovesbdb+4960,
-  magicmovesbdb+5056, magicmovesbdb+2720,  magicmovesbdb+864, magicmovesbdb+1248,
-  magicmovesbdb+1632, magicmovesbdb+2272, magicmovesbdb+4896, magicmovesbdb+5184
-};
-
-U64 magicmovesrdb[102400];
-const U64* magicmoves_r_indices[64]=
-{
-  magicmovesrdb+86016, magicmovesrdb+73728, magicmovesrdb+36864, magicmovesrdb+43008,
-  magicmovesrdb+47104, magicmovesrdb+51200, magicmovesrdb+77824, magicmovesrdb+94208,
-  magicmovesrdb+69632, magicmovesrdb+32768, magicmovesrdb+38912, magicmovesrdb+10240,
-  magicmovesrdb+14336, magicmovesrdb+53248, magicmovesrdb+57344, magicmovesrdb+81920,
-  magicmovesrdb+24576, magicmovesrdb+33792,  magicmovesrdb+6144, magicmovesrdb+11264,
-  magicmovesrdb+15360, magicmovesrdb+18432, magicmovesrdb+58368, magicmovesrdb+61440,
-  magicmovesrdb+26624,  magicmovesrdb+4096,  magicmovesrdb+7168,     magicmovesrdb+0,
-   magicmovesrdb+2048, magicmovesrdb+19456, magicmovesrdb+22528, magicmovesrdb+63488,
-  magicmovesrdb+28672,  magicmovesrdb+5120,  magicmovesrdb+8192,  magicmovesrdb+1024,
-   magicmovesrdb+3072, magicmovesrdb+20480, magicmovesrdb+23552, magicmovesrdb+65536,
-  magicmovesrdb+30720, magicmovesrdb+34816,  magicmovesrdb+9216, magicmovesrdb+12288,
-  magicmovesrdb+16384, magicmovesrdb+21504, magicmovesrdb+59392, magicmovesrdb+67584,
-  magicmovesrdb+71680, magicmovesrdb+35840, magicmovesrdb+39936, magicmovesrdb+13312,
-  magicmovesrdb+17408, magicmovesrdb+54272, magicmovesrdb+60416, magicmovesrdb+83968,
-  magicmovesrdb+90112, magicmovesrdb+75776, magicmovesrdb+40960, magicmovesrdb+45056,
-  magicmovesrdb+49152, magicmovesrdb+55296, magicmovesrdb+79872, magicmovesrdb+98304
-};
-
-U64 initmagicmoves_occ(const int* squares, const int numSquares, const U64 linocc)
-{
-  int i;
-  U64 ret=0;
-  for(i=0;i<numSquares;i++)
-    if(linocc&(((U64)(1))<<i)) ret|=(((U64)(1))<<squares[i]);
-  return ret;
-}
 
-U64 initmagicmoves_Rmoves(const int square, const U64 occ)
+constexpr U64 initmagicmoves_Rmoves(const int square, const U64 occ)
 {
   U64 ret=0;
-  U64 bit;
+  U64 bit=0;
   U64 rowbits=(((U64)0xFF)<<(8*(square/8)));
   
   bit=(((U64)(1))<<square);
@@ -225,11 +175,11 @@ U64 initmagicmoves_Rmoves(const int square, const U64 occ)
   return ret;
 }
 
-U64 initmagicmoves_Bmoves(const int square, const U64 occ)
+constexpr U64 initmagicmoves_Bmoves(const int square, const U64 occ)
 {
   U64 ret=0;
-  U64 bit;
-  U64 bit2;
+  U64 bit=0;
+  U64 bit2=0;
   U64 rowbits=(((U64)0xFF)<<(8*(square/8)));
   
   bit=(((U64)(1))<<square);
@@ -271,99 +221,98 @@ U64 initmagicmoves_Bmoves(const int square, const U64 occ)
   return ret;
 }
 
-//used so that the original indices can be left as const so that the compiler can optimize better
+/*
+ *Rodent: the move databases are generated at compile time instead of by
+ *initmagicmoves(), so that they are placed in read-only data, shared by all
+ *engine processes and ready without any work at startup. Each square gets
+ *a table of its own, since a single constant expression filling the whole
+ *rook database exceeds the evaluation limits of compilers. Occupancy subsets
+ *of a mask are enumerated with the carry-rippler trick.
+ */
 
-    #define BmagicNOMASK2(square, occupancy) *(magicmoves_b_indices2[square]+(((occupancy)*magicmoves_b_magics[square])>>magicmoves_b_shift[square]))
-    #define RmagicNOMASK2(square, occupancy) *(magicmoves_r_indices2[square]+(((occupancy)*magicmoves_r_magics[square])>>magicmoves_r_shift[square]))
+template <int bits> struct MM_TABLE { U64 moves[((U64)(1))<<bits]; };
 
-void initmagicmoves(void)
+template <int square> constexpr MM_TABLE<64-magicmoves_r_shift[square]> initmagicmoves_Rtable()
 {
-  int i;
-
-  //for bitscans :
-  //initmagicmoves_bitpos64_database[(x*C64(0x07EDD5E59A4E28C2))>>58]
-  int initmagicmoves_bitpos64_database[64]={
-  63,  0, 58,  1, 59, 47, 53,  2,
-  60, 39, 48, 27, 54, 33, 42,  3,
-  61, 51, 37, 40, 49, 18, 28, 20,
-  55, 30, 34, 11, 43, 14, 22,  4,
-  62, 57, 46, 52, 38, 26, 32, 41,
-  50, 36, 17, 19, 29, 10, 13, 21,
-  56, 45, 25, 31, 35, 16,  9, 12,
-  44, 24, 15,  8, 23,  7,  6,  5};
-
-  //identical to magicmove_x_indices except without the const modifer
-  U64* magicmoves_b_indices2[64]=
+  MM_TABLE<64-magicmoves_r_shift[square]> t{};
+  U64 occ=0;
+  do
   {
-    magicmovesbdb+4992, magicmovesbdb+2624,  magicmovesbdb+256,  magicmovesbdb+896,
-    magicmovesbdb+1280, magicmovesbdb+1664, magicmovesbdb+4800, magicmovesbdb+5120,
-    magicmovesbdb+2560, magicmovesbdb+2656,  magicmovesbdb+288,  magicmovesbdb+928,
-    magicmovesbdb+1312, magicmovesbdb+1696, magicmovesbdb+4832, magicmovesbdb+4928,
-    magicmovesbdb+0,     magicmovesbdb+128,  magicmovesbdb+320,  magicmovesbdb+960,
-    magicmovesbdb+1344, magicmovesbdb+1728, magicmovesbdb+2304, magicmovesbdb+2432,
-    magicmovesbdb+32,    magicmovesbdb+160,  magicmovesbdb+448, magicmovesbdb+2752,
-    magicmovesbdb+3776, magicmovesbdb+1856, magicmovesbdb+2336, magicmovesbdb+2464,
-    magicmovesbdb+64,    magicmovesbdb+192,  magicmovesbdb+576, magicmovesbdb+3264,
-    magicmovesbdb+4288, magicmovesbdb+1984, magicmovesbdb+2368, magicmovesbdb+2496,
-    magicmovesbdb+96,    magicmovesbdb+224,  magicmovesbdb+704, magicmovesbdb+1088,
-    magicmovesbdb+1472, magicmovesbdb+2112, magicmovesbdb+2400, magicmovesbdb+2528,
-    magicmovesbdb+2592, magicmovesbdb+2688,  magicmovesbdb+832, magicmovesbdb+1216,
-    magicmovesbdb+1600, magicmovesbdb+2240, magicmovesbdb+4864, magicmovesbdb+4960,
-    magicmovesbdb+5056, magicmovesbdb+2720,  magicmovesbdb+864, magicmovesbdb+1248,
-    magicmovesbdb+1632, magicmovesbdb+2272, magicmovesbdb+4896, magicmovesbdb+5184
-  };
-  U64* magicmoves_r_indices2[64]=
+    t.moves[(occ*magicmoves_r_magics[square])>>magicmoves_r_shift[square]]=initmagicmoves_Rmoves(square,occ);
+    occ=(occ-magicmoves_r_mask[square])&magicmoves_r_mask[square];
+  } while(occ);
+  return t;
+}
+
+template <int square> constexpr MM_TABLE<64-magicmoves_b_shift[square]> initmagicmoves_Btable()
+{
+  MM_TABLE<64-magicmoves_b_shift[square]> t{};
+  U64 occ=0;
+  do
   {
-    magicmovesrdb+86016, magicmovesrdb+73728, magicmovesrdb+36864, magicmovesrdb+43008,
-    magicmovesrdb+47104, magicmovesrdb+51200, magicmovesrdb+77824, magicmovesrdb+94208,
-    magicmovesrdb+69632, magicmovesrdb+32768, magicmovesrdb+38912, magicmovesrdb+10240,
-    magicmovesrdb+14336, magicmovesrdb+53248, magicmovesrdb+57344, magicmovesrdb+81920,
-    magicmovesrdb+24576, magicmovesrdb+33792,  magicmovesrdb+6144, magicmovesrdb+11264,
-    magicmovesrdb+15360, magicmovesrdb+18432, magicmovesrdb+58368, magicmovesrdb+61440,
-    magicmovesrdb+26624,  magicmovesrdb+4096,  magicmovesrdb+7168,     magicmovesrdb+0,
-    magicmovesrdb+2048,  magicmovesrdb+19456, magicmovesrdb+22528, magicmovesrdb+63488,
-    magicmovesrdb+28672,  magicmovesrdb+5120,  magicmovesrdb+8192,  magicmovesrdb+1024,
-    magicmovesrdb+3072,  magicmovesrdb+20480, magicmovesrdb+23552, magicmovesrdb+65536,
-    magicmovesrdb+30720, magicmovesrdb+34816,  magicmovesrdb+9216, magicmovesrdb+12288,
-    magicmovesrdb+16384, magicmovesrdb+21504, magicmovesrdb+59392, magicmovesrdb+67584,
-    magicmovesrdb+71680, magicmovesrdb+35840, magicmovesrdb+39936, magicmovesrdb+13312,
-    magicmovesrdb+17408, magicmovesrdb+54272, magicmovesrdb+60416, magicmovesrdb+83968,
-    magicmovesrdb+90112, magicmovesrdb+75776, magicmovesrdb+40960, magicmovesrdb+45056,
-    magicmovesrdb+49152, magicmovesrdb+55296, magicmovesrdb+79872, magicmovesrdb+98304
-  };
+    t.moves[(occ*magicmoves_b_magics[square])>>magicmoves_b_shift[square]]=initmagicmoves_Bmoves(square,occ);
+    occ=(occ-magicmoves_b_mask[square])&magicmoves_b_mask[square];
+  } while(occ);
+  return t;
+}
 
-  for(i=0;i<64;i++)
+template <int square> constexpr MM_TABLE<64-magicmoves_r_shift[square]> magicmovesrdb=initmagicmoves_Rtable<square>();
+template <int square> constexpr MM_TABLE<64-magicmoves_b_shift[square]> magicmovesbdb=initmagicmoves_Btable<square>();
+
+#define MM_RANK(db, sq) db<sq>.moves, db<sq+1>.moves, db<sq+2>.moves, db<sq+3>.moves, \
+                        db<sq+4>.moves, db<sq+5>.moves, db<sq+6>.moves, db<sq+7>.moves
+#define MM_BOARD(db) MM_RANK(db, 0), MM_RANK(db, 8), MM_RANK(db, 16), MM_RANK(db, 24), \
+                     MM_RANK(db, 32), MM_RANK(db, 40), MM_RANK(db, 48), MM_RANK(db, 56)
+
+const U64* const magicmoves_b_indices[64]={ MM_BOARD(magicmovesbdb) };
+const U64* const magicmoves_r_indices[64]={ MM_BOARD(magicmovesrdb) };
+
+#ifdef USE_PEXT
+
+/*
+ *Rodent: databases for PEXT indexing. PEXT packs the occupancy bits under
+ *the mask in order, which is also the order in which the carry-rippler
+ *visits subsets, so the index of a subset is its number. Entries are copied
+ *from the magic databases, and every square needs 2^popcount(mask) of them.
+ */
+
+constexpr int initmagicmoves_bitcount(U64 bb)
+{
+  int ret=0;
+  for(;bb;bb&=bb-1) ret++;
+  return ret;
+}
+
+template <int square> constexpr MM_TABLE<initmagicmoves_bitcount(magicmoves_r_mask[square])> initpextmoves_Rtable()
+{
+  MM_TABLE<initmagicmoves_bitcount(magicmoves_r_mask[square])> t{};
+  U64 occ=0;
+  int i=0;
+  do
   {
-    int squares[64];
-    int numsquares=0;
-    U64 temp=magicmoves_b_mask[i];
-    while(temp)
-    {
-      U64 bit=temp&-temp;
-      squares[numsquares++]=initmagicmoves_bitpos64_database[(bit*C64(0x07EDD5E59A4E28C2))>>58];
-      temp^=bit;
-    }
-    for(temp=0;temp<(((U64)(1))<<numsquares);temp++)
-    {
-      U64 tempocc=initmagicmoves_occ(squares,numsquares,temp);
-      BmagicNOMASK2(i,tempocc)=initmagicmoves_Bmoves(i,tempocc);
-    }
-  }
-  for(i=0;i<64;i++)
+    t.moves[i++]=magicmovesrdb<square>.moves[(occ*magicmoves_r_magics[square])>>magicmoves_r_shift[square]];
+    occ=(occ-magicmoves_r_mask[square])&magicmoves_r_mask[square];
+  } while(occ);
+  return t;
+}
+
+template <int square> constexpr MM_TABLE<initmagicmoves_bitcount(magicmoves_b_mask[square])> initpextmoves_Btable()
+{
+  MM_TABLE<initmagicmoves_bitcount(magicmoves_b_mask[square])> t{};
+  U64 occ=0;
+  int i=0;
+  do
   {
-    int squares[64];
-    int numsquares=0;
-    U64 temp=magicmoves_r_mask[i];
-    while(temp)
-    {
-      U64 bit=temp&-temp;
-      squares[numsquares++]=initmagicmoves_bitpos64_database[(bit*C64(0x07EDD5E59A4E28C2))>>58];
-      temp^=bit;
-    }
-    for(temp=0;temp<(((U64)(1))<<numsquares);temp++)
-    {
-      U64 tempocc=initmagicmoves_occ(squares,numsquares,temp);
-      RmagicNOMASK2(i,tempocc)=initmagicmoves_Rmoves(i,tempocc);
-    }
-  }
+    t.moves[i++]=magicmovesbdb<square>.moves[(occ*magicmoves_b_magics[square])>>magicmoves_b_shift[square]];
+    occ=(occ-magicmoves_b_mask[square])&magicmoves_b_mask[square];
+  } while(occ);
+  return t;
 }
+
+template <int square> constexpr MM_TABLE<initmagicmoves_bitcount(magicmoves_r_mask[square])> pextmovesrdb=initpextmoves_Rtable<square>();
+template <int square> constexpr MM_TABLE<initmagicmoves_bitcount(magicmoves_b_mask[square])> pextmovesbdb=initpextmoves_Btable<square>();
+
+const U64* const pextmoves_b_indices[64]={ MM_BOARD(pextmovesbdb) };
+const U64* const pextmoves_r_indices[64]={ MM_BOARD(pextmovesrdb) };
+
+#endif //USE_PEXT
@@ -5,8 +5,9 @@
  *need this functionality.
  *
  *Usage:
- *You must first initialize the generator with a call to initmagicmoves().
- *Then you can use the following macros for generating move bitboards by
+ *The move databases are generated at compile time (altered for Rodent, the
+ *original generator had to be initialized with initmagicmoves()), so you
+ *can use the following macros for generating move bitboards by
  *giving them a square and an occupancy.  The macro will then "return"
  *the correct move bitboard for that particular square and occupancy. It
  *has been named Rmagic and Bmagic so that it will not conflict with
@@ -100,11 +101,8 @@ extern const unsigned int magicmoves_r_shift[64];
       #define Rmagic(square, occupancy) *(magicmoves_r_indices[square]+((((occupancy)&magicmoves_r_mask[square])*magicmoves_r_magics[square])>>magicmoves_r_shift[square]))
    #endif //USE_INLINING
 
-    //extern U64 magicmovesbdb[5248];
-    extern const U64* magicmoves_b_indices[64];
-
-    //extern U64 magicmovesrdb[102400];
-    extern const U64* magicmoves_r_indices[64];
+    extern const U64* const magicmoves_b_indices[64];
+    extern const U64* const magicmoves_r_indices[64];
 
 #ifdef USE_INLINING
   static MMINLINE U64 Bmagic(const unsigned int square,const U64 occupancy)
@@ -127,6 +125,11 @@ extern const unsigned int magicmoves_r_shift[64];
 
 #endif //USE_INLINING
 
-void initmagicmoves(void);
+//Rodent: BMI2 builds also get databases indexed by PEXT instead of magics
+#if defined(__BMI2__) && !defined(NO_PEXT)
+  #define USE_PEXT
+  extern const U64* const pextmoves_b_indices[64];
+  extern const U64* const pextmoves_r_indices[64];
+#endif
 
 #endif //_magicmoveshvesh
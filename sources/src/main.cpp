@@ -17,13 +17,14 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <string.h>
 #include "rodent.h"
 #include "timer.h"
 #include "book.h"
 #include "param.h"
 
 cBitBoard BB;
-cMask Mask;
+cKpk Kpk;
 sTimer Timer; // class for setting and observing time limits
 sBook  MainBook;  // opening book
 sBook  GuideBook;
@@ -65,26 +66,41 @@ int EloToBlur(int elo) {
   return 0;
 }
 
-int main() {
+// @InitEngine() sets default options and computes the tables that are not
+// generated at compile time. It is separate from main(), so that "make lib"
+// can provide it.
+
+void InitEngine(void) {
 
   fl_reading_personality = 0;
   fl_separate_books = 0; // opening book files can be defined in a personality description
   fl_elo_slider = 0;
+  fl_poll_input = 1;
   time_percentage = 100;
   use_book = 1;
   panel_style = 0;
   verbose = 1;
+  multi_pv = 1;
+  tb_probe_depth = 1;
+  tb_probe_limit = 6;
   hist_limit = 24576;
   hist_perc = 175;
 
   Timer.Init();
   BB.Init();
-  Mask.Init();
-  Init();
+  Kpk.Init();
   InitWeights();
   Param.Default();
   Param.DynamicInit();
   InitSearch();
+}
+
+#ifndef RODENT_LIB
+
+int main(int argc, char *argv[]) {
+
+  InitEngine();
+  ProcsInit();
 #ifdef _WIN32 || _WIN64
   // if we are on Windows search for books and settings in same directory as rodentII.exe
   MainBook.bookName = "books/rodent.bin";
@@ -138,8 +154,36 @@ int main() {
 #endif
   MainBook.OpenPolyglot();
   GuideBook.OpenPolyglot();
+
+  // "rodentII bench <options>", "rodentII perfttest <options>",
+  // "rodentII procstest <options>" and "rodentII kpktest" run a single
+  // command and quit, returning non-zero exit code if the test fails
+  // (used by "make test" and "make build-pgo")
+
+  if (argc > 1
+  && (strcmp(argv[1], "bench") == 0 || strcmp(argv[1], "perfttest") == 0
+   || strcmp(argv[1], "procstest") == 0 || strcmp(argv[1], "kpktest") == 0)) {
+    char args[4096] = "";
+    int result;
+    for (int i = 2; i < argc; i++) {
+      strncat(args, argv[i], sizeof(args) - strlen(args) - 2);
+      strcat(args, " ");
+    }
+    AllocTrans(16);
+    fl_poll_input = 0; // there is no GUI to send "stop"
+    if (strcmp(argv[1], "bench") == 0)          result = Bench(args);
+    else if (strcmp(argv[1], "perfttest") == 0) result = (PerftTest(args) != 0);
+    else if (strcmp(argv[1], "procstest") == 0) result = (ProcsTest(args) != 0);
+    else                                        result = (Kpk.Verify() != 0);
+    MainBook.ClosePolyglot();
+    GuideBook.ClosePolyglot();
+    return result;
+  }
+
   UciLoop();
   MainBook.ClosePolyglot();
   GuideBook.ClosePolyglot();
   return 0;
 }
+
+#endif
@@ -47,24 +47,24 @@ void POS::DoMove(int move, UNDO *u) {
   // Update pawn hash
 
   if (ftp == P || ftp == K)
-    pawn_key ^= zob_piece[Pc(sd, ftp)][fsq] ^ zob_piece[Pc(sd, ftp)][tsq];
+    pawn_key ^= Zob.piece[Pc(sd, ftp)][fsq] ^ Zob.piece[Pc(sd, ftp)][tsq];
 
   // Update castling rights
 
-  hash_key ^= zob_castle[castle_flags];
+  hash_key ^= Zob.castle[castle_flags];
   castle_flags &= castle_mask[fsq] & castle_mask[tsq];
-  hash_key ^= zob_castle[castle_flags];
+  hash_key ^= Zob.castle[castle_flags];
 
   // Clear en passant square
 
   if (ep_sq != NO_SQ) {
-    hash_key ^= zob_ep[File(ep_sq)];
+    hash_key ^= Zob.ep[File(ep_sq)];
     ep_sq = NO_SQ;
   }
 
   pc[fsq] = NO_PC;
   pc[tsq] = Pc(sd, ftp);
-  hash_key ^= zob_piece[Pc(sd, ftp)][fsq] ^ zob_piece[Pc(sd, ftp)][tsq];
+  hash_key ^= Zob.piece[Pc(sd, ftp)][fsq] ^ Zob.piece[Pc(sd, ftp)][tsq];
   cl_bb[sd] ^= SqBb(fsq) | SqBb(tsq);
   tp_bb[ftp] ^= SqBb(fsq) | SqBb(tsq);
   mg_sc[sd] += Param.mg_pst[sd][ftp][tsq] - Param.mg_pst[sd][ftp][fsq];
@@ -77,10 +77,10 @@ void POS::DoMove(int move, UNDO *u) {
   // Capture enemy piece
 
   if (ttp != NO_TP) {
-    hash_key ^= zob_piece[Pc(op, ttp)][tsq];
+    hash_key ^= Zob.piece[Pc(op, ttp)][tsq];
 
     if (ttp == P)
-      pawn_key ^= zob_piece[Pc(op, ttp)][tsq];
+      pawn_key ^= Zob.piece[Pc(op, ttp)][tsq];
 
     cl_bb[op] ^= SqBb(tsq);
     tp_bb[ttp] ^= SqBb(tsq);
@@ -108,7 +108,7 @@ void POS::DoMove(int move, UNDO *u) {
   
     pc[fsq] = NO_PC;
     pc[tsq] = Pc(sd, R);
-    hash_key ^= zob_piece[Pc(sd, R)][fsq] ^ zob_piece[Pc(sd, R)][tsq];
+    hash_key ^= Zob.piece[Pc(sd, R)][fsq] ^ Zob.piece[Pc(sd, R)][tsq];
     cl_bb[sd] ^= SqBb(fsq) | SqBb(tsq);
     tp_bb[R]  ^= SqBb(fsq) | SqBb(tsq);
     mg_sc[sd] += Param.mg_pst[sd][R][tsq] - Param.mg_pst[sd][R][fsq];
@@ -118,8 +118,8 @@ void POS::DoMove(int move, UNDO *u) {
   case EP_CAP:
     tsq ^= 8;
     pc[tsq] = NO_PC;
-    hash_key ^= zob_piece[Pc(op, P)][tsq];
-    pawn_key ^= zob_piece[Pc(op, P)][tsq];
+    hash_key ^= Zob.piece[Pc(op, P)][tsq];
+    pawn_key ^= Zob.piece[Pc(op, P)][tsq];
     cl_bb[op] ^= SqBb(tsq);
     tp_bb[P] ^= SqBb(tsq);
     phase -= phase_value[P];
@@ -132,15 +132,15 @@ void POS::DoMove(int move, UNDO *u) {
     tsq ^= 8;
     if (BB.PawnAttacks(sd, tsq) & (cl_bb[op] & tp_bb[P]) ) {
       ep_sq = tsq;
-      hash_key ^= zob_ep[File(tsq)];
+      hash_key ^= Zob.ep[File(tsq)];
     }
     break;
 
   case N_PROM: case B_PROM: case R_PROM: case Q_PROM:
     ftp = PromType(move);
     pc[tsq] = Pc(sd, ftp);
-    hash_key ^= zob_piece[Pc(sd, P)][tsq] ^ zob_piece[Pc(sd, ftp)][tsq];
-    pawn_key ^= zob_piece[Pc(sd, P)][tsq];
+    hash_key ^= Zob.piece[Pc(sd, P)][tsq] ^ Zob.piece[Pc(sd, ftp)][tsq];
+    pawn_key ^= Zob.piece[Pc(sd, P)][tsq];
     tp_bb[P] ^= SqBb(tsq);
     tp_bb[ftp] ^= SqBb(tsq);
     phase += phase_value[ftp] - phase_value[P];
@@ -170,7 +170,7 @@ void POS::DoNull(UNDO *u) {
   // Clear en passant square
 
   if (ep_sq != NO_SQ) {
-    hash_key ^= zob_ep[File(ep_sq)];
+    hash_key ^= Zob.ep[File(ep_sq)];
     ep_sq = NO_SQ;
   }
 
@@ -19,16 +19,39 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "rodent.h"
 #include <assert.h>
+#include <string.h>
 #include "param.h"
 
-void InitMoves(POS *p, MOVES *m, int trans_move, int ref_move, int ply) {
+// With legal move generation, moves are tested against pins and checks
+// found once per node, both in generated lists and for single moves
+// (hash move, killers, refutation) returned by the picker.
+
+#ifdef USE_LEGAL_MOVEGEN
+#define PickerLegal(m, move)  KeepsKingSafe((m)->p, move, &(m)->ci)
+#define PickerFilter(m)       (m)->last = FilterLegal((m)->p, (m)->move, (m)->last, &(m)->ci)
+#else
+#define PickerLegal(m, move)  1
+#define PickerFilter(m)
+#endif
+
+void InitMoves(POS *p, MOVES *m, int trans_move, int ref_move, STACK_ENTRY *ss) {
 
   m->p = p;
-  m->phase = 0;
   m->trans_move = trans_move;
   m->ref_move = ref_move;
-  m->killer1 = killer[ply][0];
-  m->killer2 = killer[ply][1];
+  m->killer1 = ss->killer[0];
+  m->killer2 = ss->killer[1];
+  m->cont1 = ContHist(ss, 1);
+  m->cont2 = ContHist(ss, 2);
+
+  // In check, we use a dedicated evasion generator
+
+#ifdef USE_LEGAL_MOVEGEN
+  InitCheckInfo(p, &m->ci);
+  m->phase = m->ci.bbCheckers ? 10 : 0;
+#else
+  m->phase = InCheck(p) ? 10 : 0;
+#endif
 }
 
 int NextMove(MOVES *m, int *flag) {
@@ -39,7 +62,8 @@ int NextMove(MOVES *m, int *flag) {
   case 0: // return transposition table move, if legal
     move = m->trans_move;
     if (move 
-    && Legal(m->p, move)) {
+    && Legal(m->p, move)
+    && PickerLegal(m, move)) {
       m->phase = 1;
       *flag = MV_HASH;
       return move;
@@ -47,6 +71,7 @@ int NextMove(MOVES *m, int *flag) {
 
   case 1: // helper phase: generate captures
     m->last = GenerateCaptures(m->p, m->move);
+    PickerFilter(m);
     ScoreCaptures(m);
     m->next = m->move;
     m->badp = m->bad;
@@ -59,7 +84,7 @@ int NextMove(MOVES *m, int *flag) {
       if (move == m->trans_move)
         continue;
 
-      if (BadCapture(m->p, move)) {
+      if (BadCapture(m->p, move, MovesCheckInfo(m))) {
         *m->badp++ = move;
         continue;
       }
@@ -72,7 +97,8 @@ int NextMove(MOVES *m, int *flag) {
     if (move 
     && move != m->trans_move 
     && m->p->pc[Tsq(move)] == NO_PC 
-    && Legal(m->p, move)) {
+    && Legal(m->p, move)
+    && PickerLegal(m, move)) {
       m->phase = 4;
       *flag = MV_KILLER;
       return move;
@@ -83,7 +109,8 @@ int NextMove(MOVES *m, int *flag) {
     if (move 
     && move != m->trans_move 
     && m->p->pc[Tsq(move)] == NO_PC 
-    && Legal(m->p, move)) {
+    && Legal(m->p, move)
+    && PickerLegal(m, move)) {
       m->phase = 5;
       *flag = MV_KILLER;
       return move;
@@ -95,7 +122,8 @@ int NextMove(MOVES *m, int *flag) {
     &&  m->p->pc[Tsq(move)] == NO_PC 
     &&  move != m->killer1
     &&  move != m->killer2
-    && Legal(m->p, move)) {
+    && Legal(m->p, move)
+    && PickerLegal(m, move)) {
       m->phase = 6;
       *flag = MV_NORMAL;
       return move;
@@ -103,6 +131,7 @@ int NextMove(MOVES *m, int *flag) {
 
   case 6:  // helper phase: generate quiet moves
     m->last = GenerateQuiet(m->p, m->move);
+    PickerFilter(m);
     ScoreQuiet(m);
     m->next = m->move;
     m->phase = 7;
@@ -127,6 +156,40 @@ int NextMove(MOVES *m, int *flag) {
       *flag = MV_BADCAPT;
       return *m->next++;
     }
+    return 0;
+
+  case 10: // in check: return transposition table move, if legal
+    move = m->trans_move;
+    if (move
+    && Legal(m->p, move)
+    && PickerLegal(m, move)) {
+      m->phase = 11;
+      *flag = MV_HASH;
+      return move;
+    }
+    // fall through
+
+  case 11: // helper phase: generate evasions
+    m->last = GenerateEvasions(m->p, m->move);
+    PickerFilter(m);
+    ScoreEvasions(m);
+    m->next = m->move;
+    m->phase = 12;
+
+  case 12: // return evasions
+    while (m->next < m->last) {
+      move = SelectBest(m);
+      if (move == m->trans_move)
+        continue;
+
+      if (m->p->pc[Tsq(move)] != NO_PC || MoveType(move) == EP_CAP)
+        *flag = MV_CAPTURE;
+      else if (move == m->killer1 || move == m->killer2)
+        *flag = MV_KILLER;
+      else
+        *flag = MV_NORMAL;
+      return move;
+    }
   }
   return 0;
 }
@@ -135,7 +198,13 @@ void InitCaptures(POS *p, MOVES *m) {
 
   m->phase = 0;
   m->p = p;
+  m->cont1 = NULL;
+  m->cont2 = NULL;
   m->last = GenerateCaptures(m->p, m->move);
+#ifdef USE_LEGAL_MOVEGEN
+  InitCheckInfo(p, &m->ci);
+#endif
+  PickerFilter(m);
   ScoreCaptures(m);
   m->next = m->move;
 }
@@ -159,7 +228,7 @@ int NextCaptureOrCheck(MOVES * m)  // used in QuiesceCheck()
   case 0:
     while (m->next < m->last) {
       move = SelectBest(m);
-      if (BadCapture(m->p, move))
+      if (BadCapture(m->p, move, MovesCheckInfo(m)))
         continue;
 
       return move;
@@ -168,13 +237,14 @@ int NextCaptureOrCheck(MOVES * m)  // used in QuiesceCheck()
 
   case 1:
     m->last = GenerateQuietChecks(m->p, m->move);
+    PickerFilter(m);
     ScoreQuiet(m);
     m->phase = 2;
 
   case 2:
     while (m->next < m->last) {
       move = SelectBest(m);
-      if (Swap(m->p, Fsq(move), Tsq(move)) < 0) continue;
+      if (!SeeGE(m->p, move, 0, MovesCheckInfo(m))) continue;
       return move;
     }
   }
@@ -182,24 +252,35 @@ int NextCaptureOrCheck(MOVES * m)  // used in QuiesceCheck()
 }
 
 
+// Move scores are stored along with moves, see SelectBest(). They must
+// fit in 17 signed bits, which leaves room for history and a margin.
+
+#define ScoredMove(score, move) ((score) * (1 << MOVE_BITS) | (move))
+
+// @ScoreCaptures() orders captures by MVV/LVA. Capture history may move
+// a capture up or down by at most one MVV/LVA step.
+
 void ScoreCaptures(MOVES *m) {
 
-  int *movep, *valuep;
+  int *movep, *capt, move_score;
 
-  valuep = m->value;
-  for (movep = m->move; movep < m->last; movep++)
-    *valuep++ = MvvLva(m->p, *movep);
+  for (movep = m->move; movep < m->last; movep++) {
+    move_score = MvvLva(m->p, *movep) * 256;
+    if ((capt = CaptHist(m->p, *movep))) move_score += *capt / 16;
+    *movep = ScoredMove(move_score, *movep);
+  }
 }
 
 void ScoreQuiet(MOVES *m) {
 
-  int *movep, *valuep;
+  int *movep;
   int move_score;
 
-  valuep = m->value;
   for (movep = m->move; movep < m->last; movep++) {
-    
+
     move_score = history[m->p->pc[Fsq(*movep)]][Tsq(*movep)];
+    if (m->cont1) move_score += m->cont1[m->p->pc[Fsq(*movep)] * 64 + Tsq(*movep)];
+    if (m->cont2) move_score += m->cont2[m->p->pc[Fsq(*movep)] * 64 + Tsq(*movep)];
 
 	if (TpOnSq(m->p,Fsq(*movep)) != K)
 		move_score += Param.mg_pst[m->p->side][TpOnSq(m->p,Fsq(*movep))][Tsq(*movep)]
@@ -207,30 +288,48 @@ void ScoreQuiet(MOVES *m) {
 
 	//if (Fsq(*movep) == m->ref_sq && m->ref_sq != -1) move_score += 2048;
     
-    *valuep++ = move_score;
+    *movep = ScoredMove(move_score, *movep);
   }
 }
 
-int SelectBest(MOVES *m) {
+// @ScoreEvasions() puts captures of the checking piece first (by MVV/LVA),
+// then killers, then other moves ordered by history
 
-  int *movep, *valuep, aux;
-
-  valuep = m->value + (m->last - m->move) - 1;
-  for (movep = m->last - 1; movep > m->next; movep--) {
-    if (*valuep > *(valuep - 1)) {
-      aux = *valuep;
-      *valuep = *(valuep - 1);
-      *(valuep - 1) = aux;
-      aux = *movep;
-      *movep = *(movep - 1);
-      *(movep - 1) = aux;
-    }
-    valuep--;
+void ScoreEvasions(MOVES *m) {
+
+  int *movep, move_score;
+
+  for (movep = m->move; movep < m->last; movep++) {
+    if (m->p->pc[Tsq(*movep)] != NO_PC || MoveType(*movep) == EP_CAP)
+      move_score = HIST_LIMIT + 256 + MvvLva(m->p, *movep);
+    else if (*movep == m->killer1 || *movep == m->killer2)
+      move_score = HIST_LIMIT + 128 + (*movep == m->killer1);
+    else
+      move_score = history[m->p->pc[Fsq(*movep)]][Tsq(*movep)];
+    *movep = ScoredMove(move_score, *movep);
   }
-  return *m->next++;
 }
 
-int BadCapture(POS *p, int move) {
+// @SelectBest() returns the move with the highest score. Scores are kept
+// in the upper bits of list entries, so that finding the best move is a
+// single linear scan comparing plain integers. The best entry is swapped
+// to the front, and further scans start after it.
+
+int SelectBest(MOVES *m) {
+
+  int *best = m->next;
+  int aux;
+
+  for (int *movep = m->next + 1; movep < m->last; movep++)
+    if (*movep > *best) best = movep;
+
+  aux = *best;
+  *best = *m->next;
+  *m->next++ = aux;
+  return aux & MOVE_MASK;
+}
+
+int BadCapture(POS *p, int move, CHECK_INFO *ci) {
 
   int fsq = Fsq(move);
   int tsq = Tsq(move);
@@ -250,9 +349,9 @@ int BadCapture(POS *p, int move) {
 
   if (MoveType(move) == EP_CAP) return 0;
   
-  // We have to evaluate this capture using expensive Static Exchange Evaluation
+  // We have to evaluate this capture using Static Exchange Evaluation
 
-  return Swap(p, fsq, tsq) < 0;
+  return !SeeGE(p, move, 0, ci);
 }
 
 int MvvLva(POS *p, int move) {
@@ -275,13 +374,16 @@ void ClearHist(void) {
     for (int sq = 0; sq < 64; sq++)
       history[pc][sq] = 0;
 
+  memset(cont_hist, 0, sizeof(cont_hist));
+  memset(capt_hist, 0, sizeof(capt_hist));
+
   for (int fsq = 0; fsq < 64; fsq++)
     for (int tsq = 0; tsq < 64; tsq++)
       refutation[fsq][tsq] = 0;
 
   for (int i = 0; i < MAX_PLY; i++) {
-    killer[i][0] = 0;
-    killer[i][1] = 0;
+    search_stack[i].killer[0] = 0;
+    search_stack[i].killer[1] = 0;
   }
 }
 
@@ -292,11 +394,97 @@ void TrimHistory(void) {
       history[pc][sq] /= 2;
 }
 
-void DecreaseHistory(POS *p, int move, int depth) {
+// @ContHist() returns continuation history table for a move played at
+// given ply, indexed by piece and destination square of the move made
+// "back" plies earlier. There is none at the root and after null move.
+
+int *ContHist(STACK_ENTRY *ss, int back) {
+
+  if (ss->ply < back)
+    return NULL;
+
+  STACK_ENTRY *prev = &search_stack[ss->ply - back];
+
+  if (prev->pc == NO_PC)
+    return NULL;
+
+  return &cont_hist[back - 1][prev->pc][prev->tsq][0][0];
+}
+
+// @QuietHistory() sums up ordinary and continuation history of a move
+
+int QuietHistory(POS *p, int move, STACK_ENTRY *ss) {
+
+  int idx = p->pc[Fsq(move)] * 64 + Tsq(move);
+  int score = history[p->pc[Fsq(move)]][Tsq(move)];
+  int *cont;
+
+  if ((cont = ContHist(ss, 1))) score += cont[idx];
+  if ((cont = ContHist(ss, 2))) score += cont[idx];
+  return score;
+}
+
+static void UpdateContHist(POS *p, int move, STACK_ENTRY *ss, int bonus) {
+
+  int idx = p->pc[Fsq(move)] * 64 + Tsq(move);
+  int *cont;
+
+  for (int back = 1; back <= 2; back++) {
+    if (!(cont = ContHist(ss, back))) continue;
+
+    cont[idx] += bonus;
+
+    // Trim only the table of this continuation, as a whole it is too big
+
+    if (cont[idx] > CONT_LIMIT || cont[idx] < -CONT_LIMIT)
+      for (int i = 0; i < 12 * 64; i++)
+        cont[i] /= 2;
+  }
+}
+
+// @CaptHist() returns capture history entry of a move, indexed by moving
+// piece, destination square and captured piece type, or NULL if the move
+// is not a capture
+
+int *CaptHist(POS *p, int move) {
+
+  if (MoveType(move) == EP_CAP)
+    return &capt_hist[p->pc[Fsq(move)]][Tsq(move)][P];
+
+  if (p->pc[Tsq(move)] == NO_PC)
+    return NULL;
+
+  return &capt_hist[p->pc[Fsq(move)]][Tsq(move)][TpOnSq(p, Tsq(move))];
+}
+
+static void UpdateCaptHist(POS *p, int move, int bonus) {
+
+  int *capt = CaptHist(p, move);
+
+  if (!capt) return;
+
+  *capt += bonus;
+
+  // Prevent capture history from growing too high
+
+  if (*capt > CAPT_LIMIT || *capt < -CAPT_LIMIT) {
+    for (int pc = 0; pc < 12; pc++)
+      for (int sq = 0; sq < 64; sq++)
+        for (int tp = 0; tp < 6; tp++)
+          capt_hist[pc][sq][tp] /= 2;
+  }
+}
+
+void DecreaseHistory(POS *p, int move, int depth, STACK_ENTRY *ss) {
+
+  // Captures have their own history
+
+  UpdateCaptHist(p, move, -depth * depth);
 
   // Increment history counter
 
   history[p->pc[Fsq(move)]][Tsq(move)] -= depth * depth;
+  UpdateContHist(p, move, ss, -depth * depth);
 
   // Prevent history counters from growing too high
 
@@ -304,12 +492,15 @@ void DecreaseHistory(POS *p, int move, int depth) {
     TrimHistory();
 }
 
-void UpdateHistory(POS *p, int last_move, int move, int depth, int ply) {
+void UpdateHistory(POS *p, int last_move, int move, int depth, STACK_ENTRY *ss) {
 
-  // Don't update stuff used for move ordering if a move changes material balance
+  // Don't update stuff used for move ordering if a move changes material balance,
+  // except for capture history
 
-  if (p->pc[Tsq(move)] != NO_PC || IsProm(move) || MoveType(move) == EP_CAP)
+  if (p->pc[Tsq(move)] != NO_PC || IsProm(move) || MoveType(move) == EP_CAP) {
+    UpdateCaptHist(p, move, 2 * depth * depth);
     return;
+  }
 
   // Asserts suggested by Ferdinand Mosca because history[] would overflow
   // if p->pc[Fsq(move)] == NO_PC.  If they ever fire, either move or board 
@@ -321,6 +512,7 @@ void UpdateHistory(POS *p, int last_move, int move, int depth, int ply) {
   // Increment history counter
 
   history[p->pc[Fsq(move)]][Tsq(move)] += 2 * depth * depth;
+  UpdateContHist(p, move, ss, 2 * depth * depth);
 
   // Prevent history counters from growing too high
 
@@ -337,9 +529,9 @@ void UpdateHistory(POS *p, int last_move, int move, int depth, int ply) {
 
   // Update killer moves, taking care that they are different
 
-  if (move != killer[ply][0]) {
-    killer[ply][1] = killer[ply][0];
-    killer[ply][0] = move;
+  if (move != ss->killer[0]) {
+    ss->killer[1] = ss->killer[0];
+    ss->killer[0] = move;
   }
 }
 
@@ -29,8 +29,6 @@ public:
   int eg_pst[2][6][64];       // endgame piece-square tables (initialized depending on pst_style, pst_perc and mat_perc)
   int sp_pst_data[2][6][64];  // special piece/square tables (outposts etc.)
   int danger[512];            // table for evaluating king safety
-  int dist[64][64];           // table for evaluating king tropism
-  int chebyshev_dist[64][64]; // table for unstoppable passer detection
   int phalanx[2][64];
   int defended[2][64];
   int pst_style;
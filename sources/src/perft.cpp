@@ -0,0 +1,345 @@
+/*
+Rodent, a UCI chess playing engine derived from Sungorus 1.4
+Copyright (C) 2009-2011 Pablo Vazquez (Sungorus author)
+Copyright (C) 2011-2016 Pawel Koziol
+
+Rodent is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published
+by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+Rodent is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Perft counts leaf nodes of the tree of legal moves. It is independent
+// from the search move picker, so it serves to verify move generation
+// and to measure its speed. Moves at the last ply are counted without
+// being made, positions may be cached in a hash table and root moves
+// are shared between threads.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <atomic>
+#include "rodent.h"
+
+// Hash entries are written without locking, so the key is stored xor-ed
+// with the data: an entry torn by two threads simply fails to match.
+// Data holds node count in upper 56 bits and depth in lower 8 bits.
+
+typedef struct {
+  U64 key;
+  U64 data;
+} PERFT_ENTRY;
+
+static PERFT_ENTRY *perft_tt;
+static U64 perft_tt_size;
+
+static void PerftAllocHash(int mbsize) {
+
+  free(perft_tt);
+  perft_tt = NULL;
+  perft_tt_size = 0;
+  if (mbsize <= 0) return;
+
+  for (perft_tt_size = 1; perft_tt_size * 2 <= ((U64)mbsize << 20) / sizeof(PERFT_ENTRY); perft_tt_size *= 2)
+    ;
+  perft_tt = (PERFT_ENTRY *) calloc(perft_tt_size, sizeof(PERFT_ENTRY));
+  if (!perft_tt) perft_tt_size = 0;
+}
+
+U64 PerftCount(POS *p, int depth) {
+
+  int list[MAX_MOVES], *last;
+  U64 cnt = 0;
+  PERFT_ENTRY *entry = NULL;
+  UNDO u[1];
+
+  // Bulk counting: no need to make moves at the last ply
+
+  last = GenerateLegal(p, list);
+  if (depth <= 1) return last - list;
+
+  if (perft_tt) {
+    entry = perft_tt + (p->hash_key & (perft_tt_size - 1));
+    U64 data = entry->data;
+    if ((entry->key ^ data) == p->hash_key && (int)(data & 255) == depth)
+      return data >> 8;
+  }
+
+  for (int *movep = list; movep < last; movep++) {
+    p->DoMove(*movep, u);
+    cnt += PerftCount(p, depth - 1);
+    p->UndoMove(*movep, u);
+  }
+
+  if (entry) {
+    U64 data = (cnt << 8) | depth;
+    entry->key = p->hash_key ^ data;
+    entry->data = data;
+  }
+
+  return cnt;
+}
+
+// Each thread works on its own copy of the position, taking root moves
+// one by one from a shared counter
+
+static void PerftWorker(POS *root, int *moves, int cnt, std::atomic<int> *next_move, U64 *counts, int depth) {
+
+  POS p[1];
+  UNDO u[1];
+  int i;
+
+  *p = *root;
+  while ((i = (*next_move)++) < cnt) {
+    p->DoMove(moves[i], u);
+    counts[i] = (depth > 1) ? PerftCount(p, depth - 1) : 1;
+    p->UndoMove(moves[i], u);
+  }
+}
+
+U64 Perft(POS *p, int depth, int threads, int fl_divide) {
+
+  int moves[MAX_MOVES];
+  U64 counts[MAX_MOVES];
+  U64 total = 0;
+  std::atomic<int> next_move(0);
+  char move_str[6];
+
+  if (depth < 1) return 1;
+
+  int cnt = GenerateLegal(p, moves) - moves;
+  threads = Max(1, Min(threads, cnt));
+
+  if (threads == 1)
+    PerftWorker(p, moves, cnt, &next_move, counts, depth);
+  else {
+    std::thread *workers = new std::thread[threads];
+    for (int i = 0; i < threads; i++)
+      workers[i] = std::thread(PerftWorker, p, moves, cnt, &next_move, counts, depth);
+    for (int i = 0; i < threads; i++)
+      workers[i].join();
+    delete[] workers;
+  }
+
+  for (int i = 0; i < cnt; i++) {
+    total += counts[i];
+    if (fl_divide) {
+      MoveToStr(moves[i], move_str);
+#if defined _WIN32 || defined _WIN64
+      printf("%s: %I64u\n", move_str, counts[i]);
+#else
+      printf("%s: %llu\n", move_str, counts[i]);
+#endif
+    }
+  }
+
+  return total;
+}
+
+// "perft <depth> [threads <n>] [hash <mb>]" or "divide <depth> ...",
+// the latter listing node counts for each root move
+
+void ParsePerft(POS *p, char *ptr, int fl_divide) {
+
+  char token[80];
+  int depth = 5, threads = 1, hash_mb = 0;
+
+  ptr = ParseToken(ptr, token);
+  if (atoi(token) > 0) depth = atoi(token);
+
+  for (;;) {
+    ptr = ParseToken(ptr, token);
+    if (*token == '\0') break;
+    if (strcmp(token, "threads") == 0) {
+      ptr = ParseToken(ptr, token);
+      threads = atoi(token);
+    } else if (strcmp(token, "hash") == 0) {
+      ptr = ParseToken(ptr, token);
+      hash_mb = atoi(token);
+    }
+  }
+
+  PerftAllocHash(hash_mb);
+  Timer.SetStartTime();
+  U64 cnt = Perft(p, depth, threads, fl_divide);
+  int elapsed = Timer.GetElapsedTime();
+  U64 nps = (cnt * 1000) / (elapsed + 1);
+  PerftAllocHash(0);
+
+#if defined _WIN32 || defined _WIN64
+  printf(" perft %d : %I64u nodes in %d miliseconds (%I64u nps)\n", depth, cnt, elapsed, nps);
+#else
+  printf(" perft %d : %llu nodes in %d miliseconds (%llu nps)\n", depth, cnt, elapsed, nps);
+#endif
+}
+
+// Perft test suite, in EPD format: position followed by ";D<depth> <nodes>"
+// fields. Besides the usual positions from chessprogramming wiki, it
+// contains edge cases of castling, en passant, promotions and pins
+// collected by Martin Sedlak.
+
+static const char *perft_suite[] = {
+  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 ;D1 20 ;D2 400 ;D3 8902 ;D4 197281 ;D5 4865609 ;D6 119060324",
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1 ;D1 48 ;D2 2039 ;D3 97862 ;D4 4085603 ;D5 193690690",
+  "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1 ;D1 14 ;D2 191 ;D3 2812 ;D4 43238 ;D5 674624 ;D6 11030083 ;D7 178633661",
+  "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1 ;D1 6 ;D2 264 ;D3 9467 ;D4 422333 ;D5 15833292",
+  "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1 ;D1 6 ;D2 264 ;D3 9467 ;D4 422333 ;D5 15833292",
+  "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8 ;D1 44 ;D2 1486 ;D3 62379 ;D4 2103487 ;D5 89941194",
+  "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10 ;D1 46 ;D2 2079 ;D3 89890 ;D4 3894594 ;D5 164075551",
+  "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1 ;D6 1134888",                  // illegal en passant
+  "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1 ;D6 1015133",                 // illegal en passant
+  "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1 ;D6 1440467",                // en passant gives check
+  "5k2/8/8/8/8/8/8/4K2R w K - 0 1 ;D6 661072",                      // short castling gives check
+  "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1 ;D6 803711",                      // long castling gives check
+  "r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1 ;D4 1274206",          // castling rights
+  "r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1 ;D4 1720476",           // castling prevented
+  "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1 ;D6 3821001",                  // promotion out of check
+  "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1 ;D5 1004658",                // discovered check
+  "4k3/1P6/8/8/8/8/K7/8 w - - 0 1 ;D6 217342",                      // promotion gives check
+  "8/P1k5/K7/8/8/8/8/8 w - - 0 1 ;D6 92683",                        // underpromotion gives check
+  "K1k5/8/P7/8/8/8/8/8 w - - 0 1 ;D6 2217",                         // self stalemate
+  "8/k1P5/8/1K6/8/8/8/8 w - - 0 1 ;D7 567584",                      // stalemate and checkmate
+  "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1 ;D4 23527",                    // double check
+  NULL
+};
+
+typedef struct {
+  char fen[128];
+  int line;
+  int depth;
+  U64 expected;
+  U64 result;
+} PERFT_CASE;
+
+static void PerftTestWorker(PERFT_CASE *cases, int cnt, std::atomic<int> *next_case) {
+
+  POS p[1];
+  int i;
+
+  while ((i = (*next_case)++) < cnt) {
+    SetPosition(p, cases[i].fen);
+    cases[i].result = PerftCount(p, cases[i].depth);
+  }
+}
+
+// Reads test cases from an EPD line, skipping depths above max_depth
+
+static int PerftParseLine(const char *line, int line_no, int max_depth, PERFT_CASE *cases, int cnt, int max_cnt) {
+
+  const char *ptr = strchr(line, ';');
+  char fen[128];
+  int len = ptr ? (int)(ptr - line) : 0;
+
+  if (len <= 0 || len >= (int)sizeof(fen)) return cnt;
+  memcpy(fen, line, len);
+  fen[len] = '\0';
+
+  while (ptr && cnt < max_cnt) {
+    int depth;
+    unsigned long long expected;
+    if (sscanf(ptr, ";D%d %llu", &depth, &expected) == 2 && depth <= max_depth) {
+      strcpy(cases[cnt].fen, fen);
+      cases[cnt].line = line_no;
+      cases[cnt].depth = depth;
+      cases[cnt].expected = expected;
+      cnt++;
+    }
+    ptr = strchr(ptr + 1, ';');
+  }
+
+  return cnt;
+}
+
+// "perfttest [file <epd>] [depth <max>] [threads <n>]" checks node counts
+// of the built-in suite (or of an EPD file) up to a given depth. Test cases
+// are run in parallel; each failure is followed by a divide breakdown.
+// Returns the number of failed test cases.
+
+int PerftTest(char *ptr) {
+
+  char token[80], file_name[256], line[512];
+  int max_depth = MAX_PLY, threads = 1, cnt = 0, failed = 0, max_cnt = 4096;
+  PERFT_CASE *cases = (PERFT_CASE *) malloc(max_cnt * sizeof(PERFT_CASE));
+  std::atomic<int> next_case(0);
+  U64 total = 0;
+  POS p[1];
+
+  file_name[0] = '\0';
+
+  for (;;) {
+    ptr = ParseToken(ptr, token);
+    if (*token == '\0') break;
+    if (strcmp(token, "file") == 0) {
+      ptr = ParseToken(ptr, file_name);
+    } else if (strcmp(token, "depth") == 0) {
+      ptr = ParseToken(ptr, token);
+      max_depth = atoi(token);
+    } else if (strcmp(token, "threads") == 0) {
+      ptr = ParseToken(ptr, token);
+      threads = atoi(token);
+    }
+  }
+
+  if (file_name[0]) {
+    FILE *f = fopen(file_name, "r");
+    if (f == NULL) {
+      printf("info string cannot open %s\n", file_name);
+      free(cases);
+      return 1;
+    }
+    for (int line_no = 1; fgets(line, sizeof(line), f); line_no++)
+      cnt = PerftParseLine(line, line_no, max_depth, cases, cnt, max_cnt);
+    fclose(f);
+  } else {
+    for (int i = 0; perft_suite[i]; i++)
+      cnt = PerftParseLine(perft_suite[i], i + 1, max_depth, cases, cnt, max_cnt);
+  }
+
+  threads = Max(1, Min(threads, cnt));
+  Timer.SetStartTime();
+
+  if (threads == 1)
+    PerftTestWorker(cases, cnt, &next_case);
+  else {
+    std::thread *workers = new std::thread[threads];
+    for (int i = 0; i < threads; i++)
+      workers[i] = std::thread(PerftTestWorker, cases, cnt, &next_case);
+    for (int i = 0; i < threads; i++)
+      workers[i].join();
+    delete[] workers;
+  }
+
+  int elapsed = Timer.GetElapsedTime();
+
+  for (int i = 0; i < cnt; i++) {
+    total += cases[i].result;
+    if (cases[i].result == cases[i].expected) continue;
+
+    failed++;
+#if defined _WIN32 || defined _WIN64
+    printf("FAILED line %d depth %d: expected %I64u, got %I64u\n%s\n",
+#else
+    printf("FAILED line %d depth %d: expected %llu, got %llu\n%s\n",
+#endif
+           cases[i].line, cases[i].depth, cases[i].expected, cases[i].result, cases[i].fen);
+    SetPosition(p, cases[i].fen);
+    Perft(p, cases[i].depth, 1, 1);
+  }
+
+#if defined _WIN32 || defined _WIN64
+  printf("perft test: %d of %d passed, %I64u nodes in %d miliseconds\n", cnt - failed, cnt, total, elapsed);
+#else
+  printf("perft test: %d of %d passed, %llu nodes in %d miliseconds\n", cnt - failed, cnt, total, elapsed);
+#endif
+  free(cases);
+  return failed;
+}
@@ -0,0 +1,583 @@
+/*
+Rodent, a UCI chess playing engine derived from Sungorus 1.4
+Copyright (C) 2009-2011 Pablo Vazquez (Sungorus author)
+Copyright (C) 2011-2016 Pawel Koziol
+
+Rodent is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published
+by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+Rodent is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Multi-process search. With "setoption name Processes value n" the engine
+// forks n - 1 helper processes, meant to run one per NUMA node. Each of them
+// has its own tt, EvalTT and PawnTT, written first by itself and therefore
+// allocated in memory of its own node. Processes share only a small POSIX
+// shared memory segment, holding a command mailbox, root results of every
+// process and a table of deep hash entries. The front end process talks to
+// the GUI, forwards commands changing the search state to the helpers and
+// searches together with them; when its search ends, it stops the helpers
+// and plays the move found at the greatest depth. Linux only.
+//
+// NUMA topology is read from /sys at startup. Unless "NumaAffinity" is
+// off, process n is bound to cpus of node n modulo number of nodes before
+// it writes its tables, so that they are placed in memory of that node,
+// and pages of the shared segment are interleaved across all nodes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rodent.h"
+
+int procs_cnt = 1;  // number of search processes, including the front end
+int proc_id;        // 0 in the front end, 1.. in helper processes
+
+#ifdef USE_PROCS
+
+#include <fcntl.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#define SHARED_TT_SIZE  (1 << 16)  // 1 MB, direct-mapped
+#define SHARED_DEPTH    8          // hash entries of this depth and deeper are shared
+#define MAX_NUMA_NODES  64
+
+// Shared hash entries are written without locking. The key is stored xored
+// with the data, so that an entry torn by two processes writing at the same
+// time does not match any key (see Hyatt and Mann, "A lockless transposition
+// table implementation for parallel search").
+
+typedef struct {
+  U64 key;
+  U64 data;  // move, score, flags and depth
+} SHARED_ENTRY;
+
+typedef struct {
+  int move;
+  int ponder;
+  int score;
+  int depth;  // last completed iteration, 0 if none
+} PROC_RESULT;
+
+typedef struct {
+  sem_t wake[MAX_PROCS];  // a command is waiting for a helper
+  sem_t done;             // a helper has finished a command
+  volatile int stop;      // helpers should stop searching
+  char command[4096];
+  PROC_RESULT result[MAX_PROCS];
+  SHARED_ENTRY tt[SHARED_TT_SIZE];
+} SHARED_DATA;
+
+static SHARED_DATA *shared;
+static pid_t helper_pid[MAX_PROCS];
+
+static int fl_numa_affinity = 1;      // bind processes to nodes
+static int numa_cnt;                  // nodes having cpus
+static int numa_node[MAX_NUMA_NODES]; // their numbers
+static cpu_set_t numa_cpus[MAX_NUMA_NODES];
+static cpu_set_t start_cpus;          // affinity of the engine when started
+static char numa_info[4096];          // nodes and their cpus, as reported
+
+static void HelperLoop(void);
+
+// @ParseCpuList() reads a list like "0-3,8-11", as used in /sys
+
+static int ParseCpuList(const char *file_name, cpu_set_t *set) {
+
+  FILE *f = fopen(file_name, "r");
+  char line[4096], *ptr = line;
+  int first, last;
+
+  CPU_ZERO(set);
+  if (!f) return 0;
+  if (!fgets(line, sizeof(line), f)) line[0] = '\0';
+  fclose(f);
+
+  while (*ptr >= '0' && *ptr <= '9') {
+    first = last = (int) strtol(ptr, &ptr, 10);
+    if (*ptr == '-') last = (int) strtol(ptr + 1, &ptr, 10);
+    for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+      CPU_SET(cpu, set);
+    if (*ptr == ',') ptr++;
+  }
+  return CPU_COUNT(set);
+}
+
+// @ProcsInit() reads NUMA topology. It is reported only once processes
+// or affinity are configured, so that startup output stays unchanged.
+
+void ProcsInit(void) {
+
+  char file_name[80], *ptr = numa_info;
+  cpu_set_t nodes;
+
+  sched_getaffinity(0, sizeof(start_cpus), &start_cpus);
+  numa_cnt = 0;
+
+  if (ParseCpuList("/sys/devices/system/node/online", &nodes)) {
+    for (int node = 0; node < MAX_NUMA_NODES; node++) {
+      if (!CPU_ISSET(node, &nodes)) continue;
+      sprintf(file_name, "/sys/devices/system/node/node%d/cpulist", node);
+      if (ParseCpuList(file_name, &numa_cpus[numa_cnt]))
+        numa_node[numa_cnt++] = node;
+    }
+  }
+
+  if (numa_cnt == 0) {  // no NUMA support in kernel, one node with all cpus
+    numa_node[0] = 0;
+    numa_cpus[0] = start_cpus;
+    numa_cnt = 1;
+  }
+
+  for (int i = 0; i < numa_cnt; i++) {
+    ptr += sprintf(ptr, " node %d:", numa_node[i]);
+    for (int cpu = 0; cpu < CPU_SETSIZE && ptr - numa_info < 4000; cpu++)
+      if (CPU_ISSET(cpu, &numa_cpus[i])) ptr += sprintf(ptr, " %d", cpu);
+  }
+}
+
+// @ReportNuma() tells the GUI where processes are going to run
+
+static void ReportNuma(void) {
+  printf("info string numa: %d node(s),%s, affinity %s\n", numa_cnt, numa_info, fl_numa_affinity ? "on" : "off");
+}
+
+// @BindToNode() restricts a process to cpus of one node. Memory is then
+// allocated on that node when first written (Linux default policy).
+
+static void BindToNode(int id) {
+
+  cpu_set_t cpus = start_cpus;
+
+  if (fl_numa_affinity && numa_cnt > 1)
+    CPU_AND(&cpus, &start_cpus, &numa_cpus[id % numa_cnt]);
+  if (CPU_COUNT(&cpus) == 0) cpus = start_cpus;  // node outside of our cpu set
+  sched_setaffinity(0, sizeof(cpus), &cpus);
+}
+
+// @InterleaveShared() spreads pages of the shared segment across nodes,
+// so that no process gets all of them remote
+
+static void InterleaveShared(void) {
+
+  unsigned long mask[MAX_NUMA_NODES / (8 * sizeof(unsigned long))] = {0};
+
+  if (!fl_numa_affinity || numa_cnt < 2) return;
+
+  for (int i = 0; i < numa_cnt; i++)
+    mask[numa_node[i] / (8 * sizeof(unsigned long))] |= 1UL << (numa_node[i] % (8 * sizeof(unsigned long)));
+  syscall(SYS_mbind, shared, sizeof(SHARED_DATA), MPOL_INTERLEAVE, mask, MAX_NUMA_NODES + 1, 0);
+}
+
+// @CreateShared() maps the shared segment. It is unlinked at once, so that
+// it disappears with the last process using it, however they terminate.
+
+static int CreateShared(void) {
+
+  char name[64];
+
+  sprintf(name, "/rodentII.%d", (int)getpid());
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) return 0;
+
+  if (ftruncate(fd, sizeof(SHARED_DATA)) == 0)
+    shared = (SHARED_DATA *) mmap(NULL, sizeof(SHARED_DATA), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (shared == MAP_FAILED) shared = NULL;
+
+  shm_unlink(name);
+  close(fd);
+  return shared != NULL;
+}
+
+// @PostCommand() passes a command to all helpers. Every command is answered
+// by each helper posting "done" once; "go" is answered when search ends.
+
+static void PostCommand(const char *command, int wait) {
+
+  strcpy(shared->command, command);
+  for (int i = 1; i < procs_cnt; i++)
+    sem_post(&shared->wake[i]);
+
+  if (wait)
+    for (int i = 1; i < procs_cnt; i++)
+      sem_wait(&shared->done);
+}
+
+static void StopHelpers(void) {
+
+  PostCommand("quit", 0);
+  for (int i = 1; i < procs_cnt; i++)
+    waitpid(helper_pid[i], NULL, 0);
+  procs_cnt = 1;
+}
+
+void ProcsSet(int cnt) {
+
+  if (proc_id != 0) return;
+  cnt = Max(1, Min(cnt, MAX_PROCS));
+  if (cnt == procs_cnt) return;
+
+  if (procs_cnt > 1) StopHelpers();
+  if (cnt == 1) {
+    sched_setaffinity(0, sizeof(start_cpus), &start_cpus);  // all cpus again
+    return;
+  }
+
+  if (!shared) {
+    if (!CreateShared()) {
+      printf("info string cannot create shared memory, using one process\n");
+      return;
+    }
+    InterleaveShared();
+  }
+
+  sem_init(&shared->done, 1, 0);
+  for (int i = 1; i < cnt; i++)
+    sem_init(&shared->wake[i], 1, 0);
+  memset(shared->tt, 0, sizeof(shared->tt));
+
+  // Tables of the front end stay where they were first written,
+  // which is usually node 0 anyway
+
+  BindToNode(0);
+  ReportNuma();
+  fflush(stdout);
+  procs_cnt = cnt;
+
+  for (int i = 1; i < cnt; i++) {
+    helper_pid[i] = fork();
+    if (helper_pid[i] == 0) {
+      proc_id = i;
+      HelperLoop();  // never returns
+    }
+    if (helper_pid[i] < 0) {  // keep the helpers started so far
+      printf("info string cannot start process %d\n", i);
+      procs_cnt = i;
+      break;
+    }
+  }
+}
+
+// @HelperLoop() executes commands of the front end in a helper process.
+// Output goes nowhere and input is not polled, since the front end owns
+// the GUI connection.
+
+static void HelperLoop(void) {
+
+  char command[4096], token[180], *ptr;
+  POS p[1];
+
+  prctl(PR_SET_PDEATHSIG, SIGKILL);  // do not outlive the front end
+  if (getppid() == 1) _exit(0);
+  if (!freopen("/dev/null", "w", stdout)) _exit(1);
+
+  fl_poll_input = 0;
+  use_book = 0;
+  SetPosition(p, (char *)START_POS);
+
+  // Fresh tables are placed in memory local to this process. The inherited
+  // transposition table is dropped and the others are rewritten.
+
+  BindToNode(proc_id);
+
+  free(tt);
+  tt = (ENTRY *) calloc(tt_size, sizeof(ENTRY));
+  fl_tables_used = 1;
+  ResetEngine();
+
+  for (;;) {
+    sem_wait(&shared->wake[proc_id]);
+    strcpy(command, shared->command);
+    ptr = ParseToken(command, token);
+
+    if (strcmp(token, "quit") == 0) {
+      _exit(0);
+    } else if (strcmp(token, "setoption") == 0) {
+      ParseSetoption(ptr);
+    } else if (strcmp(token, "position") == 0) {
+      ParsePosition(p, ptr);
+    } else if (strcmp(token, "step") == 0) {
+      ParseMoves(p, ptr);
+    } else if (strcmp(token, "go") == 0) {
+      ParseGo(p, ptr);
+    }
+    sem_post(&shared->done);
+  }
+}
+
+// @ProcsForward() passes a command changing the state of search to helpers.
+// Every command changing the position or options must be forwarded, since
+// helpers have to search exactly the same position as the front end.
+
+void ProcsForward(char *command) {
+
+  if (proc_id != 0 || procs_cnt < 2) return;
+  if (strstr(command, "name Processes") || strstr(command, "name NumaAffinity")) return;
+  PostCommand(command, 1);
+}
+
+// @ProcsGo() starts helpers on the position just set up. They search
+// without a time limit, until the front end is done.
+
+void ProcsGo(char *ptr) {
+
+  char command[4096];
+
+  if (proc_id != 0 || procs_cnt < 2) return;
+
+  for (int i = 0; i < procs_cnt; i++)
+    shared->result[i].depth = 0;
+  shared->stop = 0;
+
+  snprintf(command, sizeof(command), "go %.4000s infinite", ptr);
+  PostCommand(command, 0);
+}
+
+// @ProcsLegal() makes sure that a move reported by a helper can be played
+// in the position of the front end, should they ever get out of sync
+
+static int ProcsLegal(POS *p, int move) {
+
+  CHECK_INFO ci[1];
+
+  if (!move || !Legal(p, move)) return 0;
+  InitCheckInfo(p, ci);
+  return KeepsKingSafe(p, move, ci);
+}
+
+// @ProcsStop() stops the helpers and replaces the move in pv with the one
+// found at the greatest depth by any process, unless the front end did not
+// search at all (i.e. it played a book move)
+
+void ProcsStop(POS *p, int *pv) {
+
+  char move_str[6];
+  int best = 0;
+  UNDO u[1];
+
+  if (proc_id != 0 || procs_cnt < 2) return;
+
+  shared->stop = 1;
+  for (int i = 1; i < procs_cnt; i++)
+    sem_wait(&shared->done);
+
+  if (shared->result[0].depth == 0) return;
+
+  for (int i = 1; i < procs_cnt; i++) {
+    PROC_RESULT *r = &shared->result[i];
+    if (!ProcsLegal(p, r->move)) continue;
+    if (r->depth > shared->result[best].depth
+    || (r->depth == shared->result[best].depth && r->score > shared->result[best].score))
+      best = i;
+  }
+
+  if (best != 0) {
+    pv[0] = shared->result[best].move;
+    pv[1] = 0;
+    p->DoMove(pv[0], u);
+    if (ProcsLegal(p, shared->result[best].ponder))
+      pv[1] = shared->result[best].ponder;
+    p->UndoMove(pv[0], u);
+    MoveToStr(pv[0], move_str);
+    printf("info string process %d: depth %d score %d move %s\n",
+           best, shared->result[best].depth, shared->result[best].score, move_str);
+  }
+}
+
+// @ProcsSetAffinity() switches binding to nodes, restarting the helpers
+
+void ProcsSetAffinity(int on) {
+
+  int cnt = procs_cnt;
+
+  if (proc_id != 0 || on == fl_numa_affinity) return;
+  fl_numa_affinity = on;
+  if (cnt > 1) {
+    ProcsSet(1);
+    ProcsSet(cnt);
+  } else
+    ReportNuma();
+}
+
+int ProcsStopped(void) {
+  return proc_id != 0 && shared->stop;
+}
+
+// @ProcsReport() publishes the result of a completed iteration
+
+void ProcsReport(int *pv, int score, int depth) {
+
+  if (procs_cnt < 2) return;
+
+  PROC_RESULT *r = &shared->result[proc_id];
+  r->move = pv[0];
+  r->ponder = pv[0] ? pv[1] : 0;
+  r->score = score;
+  r->depth = depth;
+}
+
+void ProcsTransStore(U64 key, int move, int score, int flags, int depth) {
+
+  if (procs_cnt < 2 || depth < SHARED_DEPTH) return;
+
+  U64 data = (U64)(move & 0xFFFF)
+           | (U64)(score & 0xFFFF) << 16
+           | (U64)flags << 32
+           | (U64)depth << 40;
+
+  SHARED_ENTRY *entry = shared->tt + (key & (SHARED_TT_SIZE - 1));
+  entry->key = key ^ data;
+  entry->data = data;
+}
+
+int ProcsTransRetrieve(U64 key, int *move, int *score, int *flags, int *depth) {
+
+  if (procs_cnt < 2 || *depth < SHARED_DEPTH) return 0;
+
+  SHARED_ENTRY *entry = shared->tt + (key & (SHARED_TT_SIZE - 1));
+  U64 data = entry->data;
+  if ((entry->key ^ data) != key) return 0;
+
+  *move = (short)(data & 0xFFFF);
+  *score = (short)((data >> 16) & 0xFFFF);
+  *flags = (data >> 32) & 0xFF;
+  *depth = (data >> 40) & 0xFF;
+  return 1;
+}
+
+void ProcsClearTrans(void) {
+
+  if (proc_id == 0 && procs_cnt > 1)
+    memset(shared->tt, 0, sizeof(shared->tt));
+}
+
+// @ProcsTest() searches a few positions with helper processes, set up with
+// "position" and "step" commands like in UCI mode. Every process must report
+// a move legal in the position of the front end, and no helper may outlive
+// the return to one process. Returns the number of failures.
+
+static const char *procs_suite[] = {  // position, then moves played by "step"
+  "startpos moves e2e4", "e7e5 g1f3",
+  "fen r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -", "e1g1 h3g2",
+  "fen 8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -", "b4f4 h4g3",
+  NULL
+};
+
+int ProcsTest(char *ptr) {
+
+  char token[180], command[4096], move_str[6];
+  int cnt = 3, depth = 8, failed = 0, reported = 0;
+  int pv[MAX_PLY];
+  pid_t pids[MAX_PROCS];
+  POS p[1];
+
+  for (;;) {
+    ptr = ParseToken(ptr, token);
+    if (*token == '\0') break;
+    if (strcmp(token, "processes") == 0) {
+      ptr = ParseToken(ptr, token);
+      cnt = Max(2, Min(atoi(token), MAX_PROCS));
+    } else if (strcmp(token, "depth") == 0) {
+      ptr = ParseToken(ptr, token);
+      depth = Max(1, atoi(token));
+    }
+  }
+
+  use_book = 0;
+  ProcsSet(cnt);
+  if (procs_cnt != cnt) {
+    printf("FAILED: started %d of %d processes\n", procs_cnt, cnt);
+    ProcsSet(1);
+    return 1;
+  }
+  memcpy(pids, helper_pid, sizeof(pids));
+
+  for (int i = 0; procs_suite[i]; i += 2) {
+    sprintf(command, "position %s", procs_suite[i]);
+    ParsePosition(p, command + 9);
+    ProcsForward(command);
+    sprintf(command, "step %s", procs_suite[i + 1]);
+    ParseMoves(p, command + 5);
+    ProcsForward(command);
+
+    Timer.Clear();
+    pondering = 0;
+    search_moves_cnt = 0;
+    Timer.SetData(FLAG_INFINITE, 1);
+    Timer.SetData(MAX_DEPTH, depth);
+    Timer.SetSideData(p->side);
+    Timer.SetMoveTiming();
+    sprintf(command, "depth %d", depth);
+    ProcsGo(command);
+    Think(p, pv);
+    ProcsStop(p, pv);
+
+    if (!ProcsLegal(p, pv[0])) {
+      printf("FAILED position %d: illegal best move\n", i / 2 + 1);
+      failed++;
+    }
+
+    for (int id = 1; id < cnt; id++) {
+      PROC_RESULT *r = &shared->result[id];
+      if (r->depth == 0) continue;  // stopped before completing an iteration
+      reported++;
+      if (!ProcsLegal(p, r->move)) {
+        MoveToStr(r->move, move_str);
+        printf("FAILED position %d: process %d reports illegal move %s\n", i / 2 + 1, id, move_str);
+        failed++;
+      }
+    }
+  }
+
+  if (!reported) {
+    printf("FAILED: no helper completed an iteration\n");
+    failed++;
+  }
+
+  ProcsSet(1);
+  for (int id = 1; id < cnt; id++) {
+    if (kill(pids[id], 0) == 0) {
+      printf("FAILED: process %d is still running\n", id);
+      failed++;
+    }
+  }
+
+  printf("procs test: %d processes, %d helper results, %d failures\n", cnt, reported, failed);
+  return failed;
+}
+
+#else
+
+void ProcsInit(void) {}
+void ProcsSet(int) {}
+void ProcsSetAffinity(int) {}
+void ProcsForward(char *) {}
+void ProcsGo(char *) {}
+void ProcsStop(POS *, int *) {}
+int ProcsStopped(void) { return 0; }
+void ProcsReport(int *, int, int) {}
+void ProcsTransStore(U64, int, int, int, int) {}
+int ProcsTransRetrieve(U64, int *, int *, int *, int *) { return 0; }
+void ProcsClearTrans(void) {}
+
+int ProcsTest(char *) {
+  printf("procs test: multi-process search is not available in this build\n");
+  return 0;
+}
+
+#endif
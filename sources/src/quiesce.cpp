@@ -5,24 +5,29 @@
 
 //#define USE_QS_HASH
 
-int Quiesce(POS *p, int ply, int alpha, int beta, int *pv) {
+int Quiesce(POS *p, STACK_ENTRY *ss, int alpha, int beta) {
 
   eData e;
-  int best, score, move, new_pv[MAX_PLY];
-  MOVES m[1];
+  int best, score, move;
+  int ply = ss->ply;
+#ifdef USE_QS_HASH
+  int *pv = ss->pv;
+#endif
+  MOVES *m = ss->m;
   UNDO u[1];
   int op = Opp(p->side);
 
   // Use dedicated quiescence search function when in check
 
-  if (InCheck(p)) return QuiesceFlee(p, ply, alpha, beta, pv);
+  if (InCheck(p)) return QuiesceFlee(p, ss, alpha, beta);
 
   // Statistics and attempt at quick exit
 
   nodes++;
+  EvalProf(eval_prof.phase = PROF_QS);
   CheckTimeout();
   if (abort_search) return 0;
-  *pv = 0;
+  ClearPv(ss);
   if (IsDraw(p)) return DrawScore(p);
   if (ply >= MAX_PLY - 1) return Eval.EvalScaleByDepth(p,ply,Eval.Return(p, &e, 1));
 
@@ -65,13 +70,16 @@ int Quiesce(POS *p, int ply, int alpha, int beta, int *pv) {
 
       // 2. SEE-based pruning of bad captures
 
-      if (BadCapture(p, move)) continue;
+      if (BadCapture(p, move, MovesCheckInfo(m))) continue;
 	}
 
+    ss->move = move;
+    ss->pc = p->pc[Fsq(move)];
+    ss->tsq = Tsq(move);
     p->DoMove(move, u);
-    if (Illegal(p)) { p->UndoMove(move, u); continue; }
+    if (IllegalMove(p)) { p->UndoMove(move, u); continue; }
 
-    score = -Quiesce(p, ply + 1, -beta, -alpha, new_pv);
+    score = -Quiesce(p, ss + 1, -beta, -alpha);
 
     p->UndoMove(move, u);
     if (abort_search) return 0;
@@ -91,7 +99,7 @@ int Quiesce(POS *p, int ply, int alpha, int beta, int *pv) {
       best = score;
       if (score > alpha) {
         alpha = score;
-        BuildPv(pv, new_pv, move);
+        UpdatePv(ss, move);
       }
     }
   }
@@ -108,20 +116,23 @@ int Quiesce(POS *p, int ply, int alpha, int beta, int *pv) {
 // plus checking moves with non-negative SEE.
 // Move selection is performed within NextCaptureOrCheck()
 
-int QuiesceChecks(POS *p, int ply, int alpha, int beta, int *pv)
+int QuiesceChecks(POS *p, STACK_ENTRY *ss, int alpha, int beta)
 {
   eData e;
-  int stand_pat, best, score, move, new_pv[MAX_PLY];
-  int is_pv = (beta > alpha + 1);
-  MOVES m[1];
+  int stand_pat, best, score, move;
+  int ply = ss->ply;
+  int *pv = ss->pv;
+  MOVES *m = ss->m;
   UNDO u[1];
 
-  if (InCheck(p)) return QuiesceFlee(p, ply, alpha, beta, pv);
+  if (InCheck(p)) return QuiesceFlee(p, ss, alpha, beta);
 
   nodes++;
+  Stat(stats.qc_nodes++);
+  EvalProf(eval_prof.phase = PROF_QS);
   CheckTimeout();
   if (abort_search) return 0;
-  *pv = 0;
+  ClearPv(ss);
   
   if (IsDraw(p)) return DrawScore(p);
 
@@ -130,24 +141,33 @@ int QuiesceChecks(POS *p, int ply, int alpha, int beta, int *pv)
 
   best = stand_pat = Eval.EvalScaleByDepth(p,ply,Eval.Return(p, &e, 1));
 
-  if (best >= beta) return best;
+  if (best >= beta) {
+    Stat(stats.qc_stand_pat++);
+    return best;
+  }
   if (best > alpha) alpha = best;
 
-  if (TransRetrieve(p->hash_key, &move, &score, alpha, beta, 0, ply))
+  if (TransRetrieve(p->hash_key, &move, &score, alpha, beta, 0, ply)) {
+     Stat(stats.qc_tt_cuts++);
      return score;
+  }
 
   InitCaptures(p, m);
   while ((move = NextCaptureOrCheck(m))) {
 
+    ss->move = move;
+    ss->pc = p->pc[Fsq(move)];
+    ss->tsq = Tsq(move);
     p->DoMove(move, u);
-    if (Illegal(p)) { p->UndoMove(move, u); continue; }
+    if (IllegalMove(p)) { p->UndoMove(move, u); continue; }
 
-    score = -Quiesce(p, ply + 1, -beta, -alpha, new_pv);
+    score = -Quiesce(p, ss + 1, -beta, -alpha);
 
     p->UndoMove(move, u);
     if (abort_search) return 0;
 
     if (score >= beta) {
+      Stat(stats.qc_cutoffs++);
       TransStore(p->hash_key, move, score, LOWER, 0, ply);
         return score;
     }
@@ -156,7 +176,7 @@ int QuiesceChecks(POS *p, int ply, int alpha, int beta, int *pv)
       best = score;
       if (score > alpha) {
         alpha = score;
-        BuildPv(pv, new_pv, move);
+        UpdatePv(ss, move);
       }
     }
   }
@@ -170,24 +190,25 @@ int QuiesceChecks(POS *p, int ply, int alpha, int beta, int *pv)
 // @QuiesceFlee() quiescence search function dedicated to escsping
 // from check. Can be called only while side to move is in check.
 
-int QuiesceFlee(POS *p, int ply, int alpha, int beta, int *pv) {
+int QuiesceFlee(POS *p, STACK_ENTRY *ss, int alpha, int beta) {
 
   eData e;
-  int best, score, move, fl_mv_type, new_pv[MAX_PLY];
-  int is_pv = (beta > alpha + 1);
-
-  MOVES m[1];
+  int best, score, move, fl_mv_type;
+  int ply = ss->ply;
+  int *pv = ss->pv;
+  MOVES *m = ss->m;
   UNDO u[1];
 
   // Periodically check for timeout, ponderhit or stop command
 
   nodes++;
+  EvalProf(eval_prof.phase = PROF_QS);
   CheckTimeout();
 
   // Quick exit on a timeout or on a statically detected draw
 
   if (abort_search) return 0;
-  if (ply) *pv = 0;
+  ClearPv(ss);
   if (IsDraw(p) ) return DrawScore(p);
 
   // Retrieving data from transposition table. We hope for a cutoff
@@ -205,15 +226,18 @@ int QuiesceFlee(POS *p, int ply, int alpha, int beta, int *pv) {
   // Init moves and variables before entering main loop
 
   best = -INF;
-  InitMoves(p, m, move, -1, ply);
+  InitMoves(p, m, move, -1, ss);
 
   // Main loop
 
   while ((move = NextMove(m, &fl_mv_type))) {
+    ss->move = move;
+    ss->pc = p->pc[Fsq(move)];
+    ss->tsq = Tsq(move);
     p->DoMove(move, u);
-    if (Illegal(p)) { p->UndoMove(move, u); continue; }
+    if (IllegalMove(p)) { p->UndoMove(move, u); continue; }
     
-    score = -Quiesce(p, ply, -beta, -alpha, new_pv);
+    score = -Quiesce(p, ss + 1, -beta, -alpha);
 
     
     p->UndoMove(move, u);
@@ -232,7 +256,7 @@ int QuiesceFlee(POS *p, int ply, int alpha, int beta, int *pv) {
       best = score;
       if (score > alpha) {
         alpha = score;
-        BuildPv(pv, new_pv, move);
+        UpdatePv(ss, move);
       }
     }
 
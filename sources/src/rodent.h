@@ -55,12 +55,17 @@ enum eSquare{
 typedef unsigned long long U64;
 
 #define MAX_PLY         64
+#define ONE_PLY         4   // search depth is counted in fractions of a ply
+#define PV_TABLE_SIZE   (MAX_PLY * (MAX_PLY + 3) / 2)
 #define MAX_MOVES       256
 #define INF             32767
 #define MATE            32000
 #define MAX_EVAL        29999
 #define MAX_INT    2147483646
+#define TB_WIN_SCORE    20000
 #define HIST_LIMIT (1 << 15)
+#define CONT_LIMIT (HIST_LIMIT / 4)
+#define CAPT_LIMIT (HIST_LIMIT / 8)
 
 #define RANK_1_BB       (U64)0x00000000000000FF
 #define RANK_2_BB       (U64)0x000000000000FF00
@@ -135,11 +140,29 @@ static const U64 bbAwayZone[2] = { RANK_8_BB | RANK_7_BB | RANK_6_BB | RANK_5_BB
 #define MoveType(x)     ((x) >> 12)
 #define IsProm(x)       ((x) & 0x4000)
 #define PromType(x)     (((x) >> 12) - 3)
+#define MOVE_BITS       15
+#define MOVE_MASK       ((1 << MOVE_BITS) - 1)
 
 #define Opp(x)          ((x) ^ 1)
 
+// Move pickers return only legal moves, using pins and check masks computed
+// once per node, so that illegal moves never reach DoMove(). Compile with
+// -DUSE_PSEUDO_LEGAL ("make build-pseudo") to test legality after DoMove()
+// instead, as Sungorus did.
+
+#ifndef USE_PSEUDO_LEGAL
+#define USE_LEGAL_MOVEGEN
+#endif
+
 #define InCheck(p)      Attacked(p, KingSq(p, p->side), Opp(p->side))
 #define Illegal(p)      Attacked(p, KingSq(p, Opp(p->side)), p->side)
+#ifdef USE_LEGAL_MOVEGEN
+#define IllegalMove(p)  0
+#define MovesCheckInfo(m) (&(m)->ci)
+#else
+#define IllegalMove(p)  Illegal(p)
+#define MovesCheckInfo(m) NULL
+#endif
 #define MayNull(p)      (((p)->cl_bb[(p)->side] & ~((p)->tp_bb[P] | (p)->tp_bb[K])) != 0)
 
 #define PcBb(p, x, y)   ((p)->cl_bb[x] & (p)->tp_bb[y])
@@ -157,6 +180,43 @@ static const U64 bbAwayZone[2] = { RANK_8_BB | RANK_7_BB | RANK_6_BB | RANK_5_BB
 
 #define USE_FIRST_ONE_INTRINSICS
 
+// Search statistics are gathered only when compiled with -DUSE_SEARCH_STATS
+// ("make build-stats"). Otherwise Stat() expands to nothing, so counting
+// costs nothing in a normal build.
+
+#ifdef USE_SEARCH_STATS
+#define Stat(x)         (x)
+#else
+#define Stat(x)
+#endif
+
+// Evaluation profiler, compiled with -DUSE_EVAL_PROFILE ("make build-evalprof"),
+// counts cpu cycles spent in each stage of Eval.Return(), as well as eval
+// calls and hash hits in the main search and in quiescence search
+
+#ifdef USE_EVAL_PROFILE
+#if defined _WIN32 || defined _WIN64
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define EvalProf(x)     (x)
+#define ProfStart()     U64 prof_time = __rdtsc()
+#define ProfStage(st)   { U64 prof_now = __rdtsc(); eval_prof.cycles[st] += prof_now - prof_time; prof_time = prof_now; }
+#else
+#define EvalProf(x)     ((void)0)
+#define ProfStart()
+#define ProfStage(st)
+#endif
+
+// Multi-process search (see procs.cpp) needs fork() and POSIX shared memory.
+// Library builds and other systems always search in a single process.
+
+#if defined(__linux__) && !defined(RODENT_LIB)
+#define USE_PROCS
+#endif
+#define MAX_PROCS       64
+
 // Compiler and architecture dependent versions of FirstOne() function,
 // triggered by defines at the top of this file.
 #ifdef USE_FIRST_ONE_INTRINSICS
@@ -232,12 +292,14 @@ typedef struct {
   U64 pawn_key;
 } UNDO;
 
+typedef struct {
+  U64 piece[12][64];
+  U64 castle[16];
+  U64 ep[8];
+} ZOBRIST;
+
 typedef class {
 private:
-  U64 p_attacks[2][64];
-  U64 n_attacks[64];
-  U64 k_attacks[64];
-
   U64 FillOcclSouth(U64 bbStart, U64 bbBlock);
   U64 FillOcclNorth(U64 bbStart, U64 bbBlock);
   U64 FillOcclEast(U64 bbStart, U64 bbBlock);
@@ -246,11 +308,11 @@ private:
   U64 FillOcclNW(U64 bbStart, U64 bbBlock);
   U64 FillOcclSE(U64 bbStart, U64 bbBlock);
   U64 FillOcclSW(U64 bbStart, U64 bbBlock);
-  U64 GetBetween(int sq1, int sq2);
 
 public:
-  U64 bbBetween[64][64];
+  int use_pext;          // sliding attacks are indexed by PEXT instead of magic multiplication
   void Init(void);
+  void SelectSliders(int pext);
   U64 ShiftFwd(U64 bb, int sd);
   U64 ShiftSideways(U64 bb);
   U64 GetWPControl(U64 bb);
@@ -274,6 +336,7 @@ public:
   U64 RookAttacks(U64 occ, int sq);
   U64 BishAttacks(U64 occ, int sq);
   U64 QueenAttacks(U64 occ, int sq);
+  U64 Between(int sq1, int sq2);
 } cBitBoard;
 
 extern cBitBoard BB;
@@ -319,10 +382,23 @@ public:
   U64 adjacent[8];
   U64 supported[2][64];
   U64 king_zone[2][64];
-  void Init(void);
 } cMask;
 
-extern cMask Mask;
+extern const cMask Mask;
+
+#define KPK_SIZE  (2 * 24 * 64 * 64)
+
+typedef class {
+private:
+  unsigned int bits[KPK_SIZE / 32];
+  int Probe(int wksq, int wpsq, int bksq, int stm);
+public:
+  void Init(void);
+  int Win(POS *p, int sd);
+  int Verify(void);
+} cKpk;
+
+extern cKpk Kpk;
 
 typedef struct {
 	int mg[2][N_OF_FACTORS];
@@ -362,8 +438,17 @@ public:
 
 extern cEval Eval;
 
+typedef struct {
+  U64 bbPinned;    // pieces of side to move pinned to its king
+  U64 bbCheckers;  // enemy pieces giving check
+  U64 bbTarget;    // squares where non-king moves may go (evasion mask)
+} CHECK_INFO;
+
 typedef struct {
   POS *p;
+  CHECK_INFO ci;
+  int *cont1;  // continuation history after the previous move (or NULL)
+  int *cont2;  // continuation history after the move before it (or NULL)
   int phase;
   int trans_move;
   int ref_move;
@@ -371,12 +456,87 @@ typedef struct {
   int killer2;
   int *next;
   int *last;
-  int move[MAX_MOVES];
-  int value[MAX_MOVES];
+  int move[MAX_MOVES];  // after scoring: (score << MOVE_BITS) | move
   int *badp;
   int bad[MAX_MOVES];
 } MOVES;
 
+// Search stack entry, holding all data of a single ply. Entries of the
+// consecutive plies are adjacent, so parent of a node is found at ss - 1.
+
+typedef struct {
+  MOVES m[1];                // move picker of this ply
+  int mv_played[MAX_MOVES];  // moves tried so far
+  int *pv;                   // principal variation found at this ply,
+  int pv_len;                // kept in a row of the triangular pv table
+  int ply;
+  int move;                  // move being searched
+  int pc;                    // moving piece, NO_PC for null move
+  int tsq;                   // destination square
+  int eval;                  // static evaluation, if computed
+  int killer[2];
+} STACK_ENTRY;
+
+#ifdef USE_SEARCH_STATS
+typedef struct {
+  U64 nodes;                 // calls of Search() past the quiescence entry
+  U64 tt_probes[MAX_PLY];    // hash probes in Search(), by remaining depth
+  U64 tt_cuts[MAX_PLY];      // ...and those returning a score
+  U64 iid;                   // internal iterative deepening searches
+  U64 beta_prunes;           // static null move
+  U64 null_tried;
+  U64 null_cuts;
+  U64 null_verified;
+  U64 verify_fails;          // null move cutoffs refuted by verification
+  U64 razor_tried;
+  U64 razor_cuts;
+  U64 fut_prunes;
+  U64 lmp_prunes;
+  U64 lmr_reductions;
+  U64 lmr_researches;
+  U64 cutoffs;               // beta cutoffs after searching moves
+  U64 first_cutoffs;         // ...on the first legal move
+  U64 cutoff_index;          // sum of cutoff move numbers
+  U64 qc_nodes;              // QuiesceChecks() nodes
+  U64 qc_stand_pat;          // ...with stand pat cutoff
+  U64 qc_tt_cuts;
+  U64 qc_cutoffs;
+} SEARCH_STATS;
+
+extern SEARCH_STATS stats;
+#endif
+
+#ifdef USE_EVAL_PROFILE
+enum eProfPhase { PROF_SEARCH, PROF_QS };
+enum eProfStage { PROF_INIT, PROF_MATERIAL, PROF_PIECES, PROF_PAWNS, PROF_HANGING, PROF_PATTERNS,
+                  PROF_PASSERS, PROF_UNSTOPPABLE, PROF_FINAL, N_OF_PROF_STAGES };
+
+typedef struct {
+  int phase;                     // who calls Eval.Return(): main search or quiescence
+  U64 calls[2];
+  U64 hash_hits[2];              // EvalTT
+  U64 pawn_probes[2];            // PawnTT, probed only on EvalTT misses
+  U64 pawn_hits[2];
+  U64 cycles[N_OF_PROF_STAGES];  // spent in full evaluations
+} EVAL_PROFILE;
+
+extern EVAL_PROFILE eval_prof;
+#endif
+
+typedef struct {
+  int move;
+  int score;
+  int prev_score;
+  U64 nodes;
+  U64 prev_nodes;
+  int pv[MAX_PLY];
+} ROOT_MOVE;
+
+typedef struct {
+  int cnt;
+  ROOT_MOVE moves[MAX_MOVES];
+} ROOT_LIST;
+
 typedef struct {
   U64 key;
   short date;
@@ -390,18 +550,25 @@ void AllocTrans(int mbsize);
 int Attacked(POS *p, int sq, int sd);
 U64 AttacksFrom(POS *p, int sq);
 U64 AttacksTo(POS *p, int sq);
-int BadCapture(POS *p, int move);
-void Bench(int depth);
+int BadCapture(POS *p, int move, CHECK_INFO *ci);
+int Bench(char *ptr);
+void BenchPv(int count);
 void BuildPv(int *dst, int *src, int move);
+int *CaptHist(POS *p, int move);
 void CheckTimeout(void);
 int CheckmateHelper(POS *p);
 void ClearEvalHash(void);
+void ClearEvalProfile(void);
 void ClearPawnHash(void);
 void ClearHist(void);
+void ClearPv(STACK_ENTRY *ss);
+void ClearSearchStats(void);
 void ClearTrans(void);
-void DecreaseHistory(POS *p, int move, int depth);
+int *ContHist(STACK_ENTRY *ss, int back);
+void DecreaseHistory(POS *p, int move, int depth, STACK_ENTRY *ss);
 void DisplayCurrmove(int move, int tried);
-void DisplayPv(int score, int *pv);
+void DisplayPv(int score, int *pv, int line);
+void DisplayMultiPv(int lines);
 void DisplaySpeed(void);
 int DrawScore(POS * p);
 int EloToSpeed(int elo);
@@ -409,21 +576,44 @@ int EloToBlur(int elo);
 int *GenerateCaptures(POS *p, int *list);
 int *GenerateQuiet(POS *p, int *list);
 int *GenerateQuietChecks(POS *p, int *list);
+int *GenerateEvasions(POS *p, int *list);
+int *GenerateLegal(POS *p, int *list);
 U64 GetNps(int elapsed);
 int GetDrawFactor(POS *p, int sd);
-void UpdateHistory(POS *p, int last_move, int move, int depth, int ply);
-void Init(void);
+void UpdateHistory(POS *p, int last_move, int move, int depth, STACK_ENTRY *ss);
 void InitSearch(void);
 void InitCaptures(POS *p, MOVES *m);
-void InitMoves(POS *p, MOVES *m, int trans_move, int ref_move, int ply);
+void InitMoves(POS *p, MOVES *m, int trans_move, int ref_move, STACK_ENTRY *ss);
+void InitRootList(POS *p, ROOT_LIST *rl);
+void InitEngine(void);
 void InitWeights(void);
 int InputAvailable(void);
+int IsMoveStr(char *move_str);
+int IsSearchMove(int move);
 U64 InitHashKey(POS * p);
 U64 InitPawnKey(POS * p);
 void Iterate(POS *p, int *pv);
 int Legal(POS *p, int move);
+void InitCheckInfo(POS *p, CHECK_INFO *ci);
+int KeepsKingSafe(POS *p, int move, CHECK_INFO *ci);
+int *FilterLegal(POS *p, int *list, int *last, CHECK_INFO *ci);
+void MicroBench(char *ptr);
 void MoveToStr(int move, char *move_str);
+void PrintEvalProfile(void);
 void PrintMove(int move);
+void PrintSearchStats(void);
+void ProcsClearTrans(void);
+void ProcsForward(char *command);
+void ProcsGo(char *ptr);
+void ProcsInit(void);
+void ProcsReport(int *pv, int score, int depth);
+void ProcsSet(int cnt);
+void ProcsSetAffinity(int on);
+void ProcsStop(POS *p, int *pv);
+int ProcsStopped(void);
+int ProcsTest(char *ptr);
+int ProcsTransRetrieve(U64 key, int *move, int *score, int *flags, int *depth);
+void ProcsTransStore(U64 key, int move, int score, int flags, int depth);
 int MvvLva(POS *p, int move);
 int NextCapture(MOVES *m);
 int NextCaptureOrCheck(MOVES * m);
@@ -432,57 +622,81 @@ void ParseGo(POS *, char *);
 void ParseMoves(POS *p, char *ptr);
 void ParsePosition(POS *, char *);
 void ParseSetoption(char *);
-int Perft(POS *p, int ply, int depth);
+U64 Perft(POS *p, int depth, int threads, int fl_divide);
+U64 PerftCount(POS *p, int depth);
+void ParsePerft(POS *p, char *ptr, int fl_divide);
+int PerftTest(char *ptr);
 void PrintBoard(POS *p);
 char *ParseToken(char *, char *);
 void PvToStr(int *, char *);
-int Quiesce(POS *p, int ply, int alpha, int beta, int *pv);
-int QuiesceChecks(POS *p, int ply, int alpha, int beta, int *pv);
-int QuiesceFlee(POS *p, int ply, int alpha, int beta, int *pv);
-U64 Random64(void);
+int Quiesce(POS *p, STACK_ENTRY *ss, int alpha, int beta);
+int QuiesceChecks(POS *p, STACK_ENTRY *ss, int alpha, int beta);
+int QuiesceFlee(POS *p, STACK_ENTRY *ss, int alpha, int beta);
+int QuietHistory(POS *p, int move, STACK_ENTRY *ss);
 void ReadLine(char *str, int n);
 void ResetEngine(void);
 int IsDraw(POS * p);
-int KPKdraw(POS *p, int sd);
 void ScoreCaptures(MOVES *);
 void ScoreQuiet(MOVES *m);
+void ScoreEvasions(MOVES *m);
 void SetWeight(int weight_name, int value);
 int Widen(POS *p, int depth, int * pv, int lastScore);
 int Refutation(int move);
 void ReadPersonality(char *fileName);
 int SearchRoot(POS *p, int ply, int alpha, int beta, int depth, int *pv);
-int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int last_move, int last_capt_sq, int node_type, int *pv);
+int Search(POS *p, STACK_ENTRY *ss, int alpha, int beta, int depth, int was_null, int last_move, int last_capt_sq, int node_type);
 int SelectBest(MOVES *m);
 void SetPosition(POS *p, char *epd);
+void SortRootList(ROOT_LIST *rl, int first);
+void SortRootListByNodes(ROOT_LIST *rl, int first);
 void SetAsymmetricEval(int sd);
 int StrToMove(POS *p, char *move_str);
 int Swap(POS *p, int from, int to);
+int SeeGE(POS *p, int move, int threshold, CHECK_INFO *ci);
+void TbFilterRootMoves(POS *p, ROOT_LIST *rl);
+void TbInit(char *path);
+int TbProbeWdl(POS *p, int ply, int *score);
 void Think(POS *p, int *pv);
 void TrimHistory(void);
 int Timeout(void);
 int TransRetrieve(U64 key, int *move, int *score, int alpha, int beta, int depth, int ply);
 void TransStore(U64 key, int move, int score, int flags, int depth, int ply);
 void UciLoop(void);
+void UpdatePv(STACK_ENTRY *ss, int move);
 
-extern int castle_mask[64];
+extern const int castle_mask[64];
 extern const int bit_table[64];
-extern const int tp_value[7];
+extern int tp_value[7];
 extern const int phase_value[7];
 extern int refutation[64][64];
 extern int root_side;
 extern int history[12][64];
-extern int killer[MAX_PLY][2];
-extern U64 zob_piece[12][64];
-extern U64 zob_castle[16];
-extern U64 zob_ep[8];
+extern int cont_hist[2][12][64][12][64];
+extern int capt_hist[12][64][6];
+extern STACK_ENTRY search_stack[MAX_PLY];
+extern int pv_table[PV_TABLE_SIZE];
+extern const ZOBRIST Zob;
 extern int pondering;
 extern int root_depth;
+extern int depth_reached;
+extern int depth_time[MAX_PLY + 1];
+extern int multi_pv;
+extern int pv_idx;
+extern ROOT_LIST root_list;
+extern int search_moves[MAX_MOVES];
+extern int search_moves_cnt;
 extern U64 nodes;
 extern int abort_search;
 extern ENTRY *tt;
 extern int tt_size;
 extern int tt_mask;
 extern int tt_date;
+extern int tb_largest;
+extern int tb_probe_depth;
+extern int tb_probe_limit;
+extern U64 tb_hits;
+extern int procs_cnt;
+extern int proc_id;
 
 extern int weights[N_OF_FACTORS];
 extern int dyn_weights[5];
@@ -496,6 +710,8 @@ extern int hist_perc;
 extern int fl_reading_personality;
 extern int fl_separate_books;
 extern int fl_elo_slider;
+extern int fl_poll_input;
+extern int fl_tables_used;
 
 int DifferentBishops(POS * p);
 int NotOnBishColor(POS * p, int bishSide, int sq);
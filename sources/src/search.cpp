@@ -31,7 +31,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define ALL_NODE -1
 #define NEW_NODE(type)     (-(type))
 
-double lmr_size[2][MAX_PLY][MAX_MOVES];
+unsigned char lmr_size[2][MAX_PLY][64]; // in 1/ONE_PLY units, indexed by Min(moves tried, 63)
 int lmp_limit[6] = { 0, 4, 8, 12, 36, 48 };
 int fut_margin[7] = { 0, 100, 150, 200, 250, 300, 350 };
 int razor_margin[5] = { 0, 300, 360, 420, 480 };
@@ -50,24 +50,46 @@ static const int use_lmp = 1;
 static const int use_lmr = 1;
 static const int lmr_hist_adjustement = 1;
 
+// Granularity of late move reductions. ONE_PLY keeps them in whole plies,
+// as they have been tuned; smaller steps give fractional reductions.
+
+static const int lmr_step = ONE_PLY;
+
 void InitSearch(void) {
 
+  // Each ply gets a row of the triangular pv table, long enough
+  // for the remaining plies and a terminating zero
+
+  int *row = pv_table;
+  for (int ply = 0; ply < MAX_PLY; ply++) {
+    search_stack[ply].ply = ply;
+    search_stack[ply].pv = row;
+    search_stack[ply].pv_len = 0;
+    row += MAX_PLY - ply + 1;
+  }
+
   // Set depth of late move reduction using modified Stockfish formula
 
   for (int dp = 0; dp < MAX_PLY; dp++)
-    for (int mv = 0; mv < MAX_MOVES; mv++) {
+    for (int mv = 0; mv < 64; mv++) {
 
-      double r = log((double)dp) * log((double)Min(mv,63)) / 2;
+      double r = log((double)dp) * log((double)mv) / 2;
       if (r < 0.80) r = 0;
 
-      lmr_size[0][dp][mv] = r;            // zero window node
-      lmr_size[1][dp][mv] = Max(r -1, 0); // principal variation node
+      double size[2];
+      size[0] = r;            // zero window node
+      size[1] = Max(r -1, 0); // principal variation node
 
       for (int node = 0; node <= 1; node++) {
-        if (lmr_size[node][dp][mv] < 1) lmr_size[node][dp][mv] = 0; // ultra-small reductions make no sense
+        if (size[node] < 1) size[node] = 0; // ultra-small reductions make no sense
 
-        if (lmr_size[node][dp][mv] > dp - 1) // reduction cannot exceed actual depth
-          lmr_size[node][dp][mv] = dp - 1;
+        if (size[node] > dp - 1) // reduction cannot exceed actual depth
+          size[node] = dp - 1;
+
+        // Store the reduction in fixed point, rounded down to lmr_step
+
+        int units = (int)(size[node] * ONE_PLY);
+        lmr_size[node][dp][mv] = units - units % lmr_step;
       }
     }
 }
@@ -77,8 +99,9 @@ void Think(POS *p, int *pv) {
   pv[1] = 0; // fixing rare glitch
 
   // Play a move from opening book, if applicable
+  // (not when the GUI restricts the choice of moves)
 
-  if (use_book) {
+  if (use_book && !search_moves_cnt) {
     pv[0] = GuideBook.GetPolyglotMove(p, 1);
     if (pv[0]) return;
 
@@ -91,24 +114,34 @@ void Think(POS *p, int *pv) {
   ClearHist();
   tt_date = (tt_date + 1) & 255;
   nodes = 0;
+  tb_hits = 0;
   abort_search = 0;
   verbose = 1;
+  ClearSearchStats();
+  ClearEvalProfile();
   Timer.SetStartTime();
 
   // Search
 
   Iterate(p, pv);
+
+#ifdef USE_EVAL_PROFILE
+  PrintEvalProfile();
+#endif
 }
 
 void Iterate(POS *p, int *pv) {
 
   int val = 0, cur_val = 0;
+  int lines;
   U64 nps = 0;
   Timer.SetIterationTiming();
   
   int max_root_depth = Timer.GetData(MAX_DEPTH);
 
   root_side = p->side;
+  depth_reached = 0;
+  fl_tables_used = 1;  // search writes history, hash and eval tables
   SetAsymmetricEval(p->side);
 
   // Are we operating in slowdown mode or on node limit?
@@ -117,6 +150,25 @@ void Iterate(POS *p, int *pv) {
   if (Timer.nps_limit 
   || Timer.GetData(MAX_NODES) > 0) Timer.special_mode = 1;
 
+  // Build the list of legal root moves. It persists between iterations,
+  // so that root moves can be ordered by the results of previous ones.
+
+  InitRootList(p, &root_list);
+  TbFilterRootMoves(p, &root_list);
+  fl_has_choice = (root_list.cnt > 1);
+
+  // No legal moves: return correct checkmate/stalemate score and quit
+
+  if (root_list.cnt == 0) {
+    pv[0] = 0;
+    cur_val = InCheck(p) ? -MATE : DrawScore(p);
+    root_depth = 1;
+    DisplayPv(cur_val, pv, 0);
+    return;
+  }
+
+  lines = Min(multi_pv, root_list.cnt);
+
   // Search with increasing depth
 
   for (root_depth = 1; root_depth <= max_root_depth; root_depth++) {
@@ -129,8 +181,41 @@ void Iterate(POS *p, int *pv) {
     printf("info depth %d time %d nodes %lld nps %lld\n", root_depth, elapsed, nodes, nps);
 #endif
 
-    if (use_aspiration) cur_val = Widen(p, root_depth, pv, cur_val);
-    else                cur_val = SearchRoot(p, 0, -INF, INF, root_depth, pv); // full window search
+    // Remember scores and effort of the previous iteration
+
+    for (int i = 0; i < root_list.cnt; i++) {
+      root_list.moves[i].prev_score = root_list.moves[i].score;
+      root_list.moves[i].prev_nodes = root_list.moves[i].nodes;
+      root_list.moves[i].nodes = 0;
+    }
+
+    // Moves outside the reported lines are ordered by the size of their
+    // subtrees in the previous iteration: a move that took long to refute
+    // is the most likely to become best.
+
+    if (root_depth > 1) SortRootListByNodes(&root_list, lines);
+
+    // Search every requested line in turn, excluding moves
+    // that have been chosen as best in the previous lines
+
+    for (pv_idx = 0; pv_idx < lines; pv_idx++) {
+      int last_val = (pv_idx == 0) ? cur_val : root_list.moves[pv_idx].prev_score;
+
+      if (use_aspiration) val = Widen(p, root_depth, pv, last_val);
+      else                val = SearchRoot(p, 0, -INF, INF, root_depth * ONE_PLY, pv); // full window search
+
+      if (pv_idx == 0) cur_val = val;
+      if (abort_search) break;
+    }
+    pv_idx = 0;
+
+    if (!abort_search) {
+      depth_reached = root_depth;
+      depth_time[root_depth] = Timer.GetElapsedTime();
+      if (procs_cnt > 1) ProcsReport(pv, cur_val, root_depth);
+    }
+
+    if (lines > 1 && !abort_search) DisplayMultiPv(lines);
 
     // don't search too deep with only one move available
 
@@ -148,7 +233,6 @@ void Iterate(POS *p, int *pv) {
     }
 
     if (abort_search || Timer.FinishIteration()) break;
-    val = cur_val;
   }
 }
 
@@ -159,36 +243,37 @@ int Widen(POS *p, int depth, int * pv, int lastScore) {
 
   int cur_val = lastScore, alpha, beta;
 
-  if (depth > 6 && lastScore < MAX_EVAL) {
+  if (depth > 6 && lastScore < MAX_EVAL && lastScore > -MAX_EVAL) {
     for (int margin = 10; margin < 500; margin *= 2) {
       alpha = lastScore - margin;
       beta  = lastScore + margin;
-      cur_val = SearchRoot(p, 0, alpha, beta, depth, pv);
+      cur_val = SearchRoot(p, 0, alpha, beta, depth * ONE_PLY, pv);
       if (abort_search) break;
-      if (cur_val < alpha) Timer.OnFailLow();
+      if (cur_val < alpha && pv_idx == 0) Timer.OnFailLow();
       if (cur_val > alpha && cur_val < beta) 
       return cur_val;                // we have finished within the window
       if (cur_val > MAX_EVAL) break; // verify mate searching with infinite bounds
     }
   }
 
-  cur_val = SearchRoot(p, 0, -INF, INF, depth, pv); // full window search
+  cur_val = SearchRoot(p, 0, -INF, INF, depth * ONE_PLY, pv); // full window search
   return cur_val;
 }
 
 int SearchRoot(POS *p, int ply, int alpha, int beta, int depth, int *pv) {
 
-  int best, score, move, new_depth, new_pv[MAX_PLY];
+  int best, score, move, new_depth;
   int fl_check, fl_prunable_move, fl_mv_type, reduction;
   int mv_tried = 0, quiet_tried = 0;
-  int mv_played[MAX_MOVES];
   int mv_hist_score;
   int victim, last_capt;
-  int move_change = 0;
-  
-  fl_has_choice = 0;
+  int alpha_orig = alpha;
+  U64 nodes_before;
+  ROOT_MOVE *rm;
+  STACK_ENTRY *ss = &search_stack[ply];
+  int *mv_played = ss->mv_played;
+  int *new_pv = (ss + 1)->pv;
   
-  MOVES m[1];
   UNDO u[1];
 
   // Periodically check for timeout, ponderhit or stop command
@@ -200,80 +285,78 @@ int SearchRoot(POS *p, int ply, int alpha, int beta, int depth, int *pv) {
   
   if (abort_search) return 0;
 
-  // Retrieving data from transposition table. We hope for a cutoff
-  // or at least for a move to improve move ordering.
-
-  move = 0;
-  if (TransRetrieve(p->hash_key, &move, &score, alpha, beta, depth, ply)) {
-    
-    // For move ordering purposes, a cutoff from hash is treated
-    // exactly like a cutoff from search
-
-    if (score >= beta) UpdateHistory(p, -1, move, depth, ply);
+  // Root moves are ordered by the root list, so transposition table
+  // is not probed here. Moves of the lines already found in multi-pv
+  // mode get no new score and sink to the end of the unsearched part.
 
-    // Root node is a pv node, so we return only exact scores
+  for (int i = pv_idx; i < root_list.cnt; i++)
+    root_list.moves[i].score = -INF;
 
-    if (score > alpha && score < beta)
-      return score;
-  }
-  
   // Are we in check? Knowing that is useful when it comes 
   // to pruning/reduction decisions
 
   fl_check = InCheck(p);
 
-  // Init moves and variables before entering main loop
-  
   best = -INF;
-  InitMoves(p, m, move, Refutation(-1), ply);
   
   // Main loop
   
-  while ((move = NextMove(m, &fl_mv_type))) {
+  for (int i = pv_idx; i < root_list.cnt; i++) {
 
-    mv_hist_score = history[p->pc[Fsq(move)]][Tsq(move)];
-	victim = TpOnSq(p, Tsq(move));
-	if (victim != NO_TP) last_capt = Tsq(move);
-	else last_capt = -1;
+    rm = &root_list.moves[i];
+    move = rm->move;
+    nodes_before = nodes;
+
+    victim = TpOnSq(p, Tsq(move));
+    if (victim != NO_TP) last_capt = Tsq(move);
+    else last_capt = -1;
+
+    if (victim == NO_TP && !IsProm(move) && MoveType(move) != EP_CAP)
+      fl_mv_type = MV_NORMAL;
+    else
+      fl_mv_type = MV_CAPTURE;
+
+    mv_hist_score = QuietHistory(p, move, ss);
+    ss->move = move;
+    ss->pc = p->pc[Fsq(move)];
+    ss->tsq = Tsq(move);
 
     p->DoMove(move, u);
-    if (Illegal(p)) { p->UndoMove(move, u); continue; }
 
     // Update move statistics (needed for reduction/pruning decisions)
 
     mv_played[mv_tried] = move;
     mv_tried++;
-    if (mv_tried > 1) fl_has_choice = 1; // we have a choice between at least two root moves
-    if (depth > 16 && verbose) DisplayCurrmove(move, mv_tried);
+    if (depth > 16 * ONE_PLY && verbose) DisplayCurrmove(move, mv_tried);
     if (fl_mv_type == MV_NORMAL) quiet_tried++;
     fl_prunable_move = !InCheck(p) && (fl_mv_type == MV_NORMAL);
 
     // Set new search depth
 
-    new_depth = depth - 1 + InCheck(p);
+    new_depth = depth - ONE_PLY + InCheck(p) * ONE_PLY;
 
     // Late move reduction
   
     reduction = 0;
   
     if (use_lmr
-    && depth >= 2
+    && depth >= 2 * ONE_PLY
     && mv_tried > 3
     && mv_hist_score < hist_limit
     && alpha > -MAX_EVAL && beta < MAX_EVAL
     && !fl_check 
     &&  fl_prunable_move
-    && lmr_size[1][depth][mv_tried] > 0
+    && lmr_size[1][depth / ONE_PLY][Min(mv_tried, 63)] > 0
     && MoveType(move) != CASTLE ) {
 
-    reduction = lmr_size[1][depth][mv_tried];
+    reduction = lmr_size[1][depth / ONE_PLY][Min(mv_tried, 63)];
 
     // increase reduction on bad history score
 
     if (mv_hist_score < 0 
-    && new_depth - reduction > 2 
+    && new_depth - reduction > 2 * ONE_PLY
     && lmr_hist_adjustement) 
-       reduction++;
+       reduction += ONE_PLY;
 
     new_depth -= reduction;
   }
@@ -283,11 +366,11 @@ int SearchRoot(POS *p, int ply, int alpha, int beta, int depth, int *pv) {
   // PVS
 
   if (best == -INF)
-    score = -Search(p, ply + 1, -beta, -alpha, new_depth, 0, move, last_capt, NEW_NODE(PV_NODE), new_pv);
+    score = -Search(p, ss + 1, -beta, -alpha, new_depth, 0, move, last_capt, NEW_NODE(PV_NODE));
   else {
-    score = -Search(p, ply + 1, -alpha - 1, -alpha, new_depth, 0, move, last_capt, CUT_NODE, new_pv);
+    score = -Search(p, ss + 1, -alpha - 1, -alpha, new_depth, 0, move, last_capt, CUT_NODE);
     if (!abort_search && score > alpha && score < beta)
-      score = -Search(p, ply + 1, -beta, -alpha, new_depth, 0, move, last_capt, PV_NODE, new_pv);
+      score = -Search(p, ss + 1, -beta, -alpha, new_depth, 0, move, last_capt, PV_NODE);
   }
 
   // Reduced move scored above alpha - we need to re-search it
@@ -299,29 +382,41 @@ int SearchRoot(POS *p, int ply, int alpha, int beta, int depth, int *pv) {
   }
 
     p->UndoMove(move, u);
+    rm->nodes += nodes - nodes_before;
     if (abort_search) return 0;
 
+    // Record the score of the first move and of every move raising alpha,
+    // together with its principal variation
+
+    if (best == -INF || score > alpha) {
+      rm->score = score;
+      BuildPv(rm->pv, new_pv, move);
+    }
+
   // Beta cutoff
 
     if (score >= beta) {
       if (!fl_check) {
-        UpdateHistory(p, -1, move, depth, ply);
+        UpdateHistory(p, -1, move, depth / ONE_PLY, ss);
         for (int mv = 0; mv < mv_tried; mv++)
-          DecreaseHistory(p, mv_played[mv], depth);
+          DecreaseHistory(p, mv_played[mv], depth / ONE_PLY, ss);
       }
-      TransStore(p->hash_key, move, score, LOWER, depth, ply);
+      if (pv_idx == 0) TransStore(p->hash_key, move, score, LOWER, depth / ONE_PLY, ply);
 
       // Update search time depending on whether the first move has changed
 
-      if (depth > 4) {
+      if (depth > 4 * ONE_PLY && pv_idx == 0) {
         if (pv[0] != move) Timer.OnNewRootMove();
         else               Timer.OnOldRootMove();
       }
 
       // Change the best move and show the new pv
 
-      BuildPv(pv, new_pv, move);
-      DisplayPv(score, pv);
+      SortRootList(&root_list, pv_idx);
+      if (pv_idx == 0) {
+        BuildPv(pv, new_pv, move);
+        if (multi_pv == 1) DisplayPv(score, pv, 0);
+      }
 
       return score;
     }
@@ -336,72 +431,149 @@ int SearchRoot(POS *p, int ply, int alpha, int beta, int depth, int *pv) {
 
         // Update search time depending on whether the first move has changed
 
-        if (depth > 4) {
+        if (depth > 4 * ONE_PLY && pv_idx == 0) {
           if (pv[0] != move) Timer.OnNewRootMove();
           else               Timer.OnOldRootMove();
         }
 
         // Change the best move and show the new pv
 
-        BuildPv(pv, new_pv, move);
-        DisplayPv(score, pv);
+        if (pv_idx == 0) {
+          BuildPv(pv, new_pv, move);
+          if (multi_pv == 1) DisplayPv(score, pv, 0);
+        }
       }
     }
 
   } // end of the main loop
 
-  // Return correct checkmate/stalemate score
+  // Bring the best moves to the front of the list
 
-  if (best == -INF)
-    return InCheck(p) ? -MATE + ply : DrawScore(p);
+  SortRootList(&root_list, pv_idx);
 
   // Save score in the transposition table
 
-  if (*pv) {
-    if (!fl_check) {
-      UpdateHistory(p, -1, *pv, depth, ply);
-      for (int mv = 0; mv < mv_tried; mv++)
-        DecreaseHistory(p, mv_played[mv], depth);
-    }
-    TransStore(p->hash_key, *pv, best, EXACT, depth, ply);
-    
-  } else
-    TransStore(p->hash_key, 0, best, UPPER, depth, ply);
+  if (pv_idx == 0) {
+    if (best > alpha_orig) {
+      if (!fl_check) {
+        UpdateHistory(p, -1, *pv, depth / ONE_PLY, ss);
+        for (int mv = 0; mv < mv_tried; mv++)
+          DecreaseHistory(p, mv_played[mv], depth / ONE_PLY, ss);
+      }
+      TransStore(p->hash_key, *pv, best, EXACT, depth / ONE_PLY, ply);
+    } else
+      TransStore(p->hash_key, 0, best, UPPER, depth / ONE_PLY, ply);
+  }
 
   return best;
 }
 
-int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int last_move, int last_capt_sq, int node_type, int *pv) {
+void InitRootList(POS *p, ROOT_LIST *rl) {
+
+  int move, fl_mv_type, tt_move = 0, tt_score, cnt = 0;
+  MOVES m[1];
+#ifndef USE_LEGAL_MOVEGEN
+  UNDO u[1];
+#endif
+
+  // Initial order of root moves comes from the move picker,
+  // so that transposition table move is tried first.
+
+  TransRetrieve(p->hash_key, &tt_move, &tt_score, -INF, INF, 0, 0);
+  InitMoves(p, m, tt_move, Refutation(-1), search_stack);
+
+  rl->cnt = 0;
+  while ((move = NextMove(m, &fl_mv_type))) {
+#ifndef USE_LEGAL_MOVEGEN
+    p->DoMove(move, u);
+    if (Illegal(p)) { p->UndoMove(move, u); continue; }
+    p->UndoMove(move, u);
+#endif
+    ROOT_MOVE *rm = &rl->moves[rl->cnt++];
+    rm->move = move;
+    rm->score = -INF;
+    rm->prev_score = -INF;
+    rm->nodes = 0;
+    rm->prev_nodes = 0;
+    rm->pv[0] = move;
+    rm->pv[1] = 0;
+  }
+
+  // If the GUI has sent "go searchmoves", only listed moves are kept.
+  // If none of them is legal, all moves are searched.
+
+  if (search_moves_cnt == 0) return;
+
+  for (int i = 0; i < rl->cnt; i++)
+    if (IsSearchMove(rl->moves[i].move))
+      rl->moves[cnt++] = rl->moves[i];
+
+  if (cnt) rl->cnt = cnt;
+  else     search_moves_cnt = 0;
+}
+
+int IsSearchMove(int move) {
+
+  if (search_moves_cnt == 0) return 1;
+
+  for (int i = 0; i < search_moves_cnt; i++)
+    if (search_moves[i] == move) return 1;
+
+  return 0;
+}
+
+void SortRootList(ROOT_LIST *rl, int first) {
+
+  // Stable insertion sort by score, so that moves with equal scores
+  // (in particular those that failed low) keep their previous order
+
+  for (int i = first + 1; i < rl->cnt; i++) {
+    ROOT_MOVE tmp = rl->moves[i];
+    int j = i - 1;
+    while (j >= first && rl->moves[j].score < tmp.score) {
+      rl->moves[j + 1] = rl->moves[j];
+      j--;
+    }
+    rl->moves[j + 1] = tmp;
+  }
+}
+
+int Search(POS *p, STACK_ENTRY *ss, int alpha, int beta, int depth, int was_null, int last_move, int last_capt_sq, int node_type) {
 
   eData e;
-  int best, score, null_score, move, new_depth, new_pv[MAX_PLY];
+  int best, score, null_score, move, new_depth;
   int fl_check, fl_prunable_node, fl_prunable_move, fl_mv_type, reduction;
   int is_pv = (node_type == PV_NODE);
   int mv_tried = 0, quiet_tried = 0, fl_futility = 0;
-
-  int mv_played[MAX_MOVES];
   int mv_hist_score;
   int victim, last_capt;
 
-  MOVES m[1];
+  // Per-ply data lives on the search stack rather than on the C stack
+
+  int ply = ss->ply;
+  int *pv = ss->pv;
+  int *mv_played = ss->mv_played;
+  MOVES *m = ss->m;
   UNDO u[1];
 
   assert(ply > 0);
 
   // Quiescence search entry point
 
-  if (depth <= 0)
-    return QuiesceChecks(p, ply, alpha, beta, pv);
+  if (depth < ONE_PLY)
+    return QuiesceChecks(p, ss, alpha, beta);
 
   // Periodically check for timeout, ponderhit or stop command
 
   nodes++;
+  Stat(stats.nodes++);
+  EvalProf(eval_prof.phase = PROF_SEARCH);
   CheckTimeout();
 
   // Quick exit on a timeout or on a statically detected draw
   
   if (abort_search) return 0;
-  if (ply) *pv = 0;
+  ClearPv(ss);
   if (IsDraw(p)) return DrawScore(p);
 
   // Mate distance pruning
@@ -424,20 +596,38 @@ int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int la
   // or at least for a move to improve move ordering.
 
   move = 0;
-  if (TransRetrieve(p->hash_key, &move, &score, alpha, beta, depth, ply)) {
+  Stat(stats.tt_probes[Min(depth / ONE_PLY, MAX_PLY - 1)]++);
+  if (TransRetrieve(p->hash_key, &move, &score, alpha, beta, depth / ONE_PLY, ply)) {
     
     // For move ordering purposes, a cutoff from hash is treated
     // exactly like a cutoff from search
 
-    if (score >= beta) UpdateHistory(p, last_move, move, depth, ply);
+    if (move && score >= beta) UpdateHistory(p, last_move, move, depth / ONE_PLY, ss);
 
     // In pv nodes only exact scores are returned. This is done because
     // there is much more pruning and reductions in zero-window nodes,
     // so retrieving such scores in pv nodes works like retrieving scores
     // from slightly lower depth.
 
-    if (!is_pv || (score > alpha && score < beta))
+    if (!is_pv || (score > alpha && score < beta)) {
+      Stat(stats.tt_cuts[Min(depth / ONE_PLY, MAX_PLY - 1)]++);
       return score;
+    }
+  }
+
+  // Probe endgame tablebases and save the result in the transposition table
+
+  if (tb_largest && depth >= tb_probe_depth * ONE_PLY) {
+    int tb_flag = TbProbeWdl(p, ply, &score);
+
+    if (tb_flag != NONE) {
+      if (tb_flag == EXACT
+      || (tb_flag == LOWER && score >= beta)
+      || (tb_flag == UPPER && score <= alpha)) {
+        TransStore(p->hash_key, 0, score, tb_flag, Min(depth / ONE_PLY + 6, MAX_PLY - 1), ply);
+        return score;
+      }
+    }
   }
 
   // Safeguard against exceeding ply limit
@@ -451,18 +641,22 @@ int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int la
   fl_check = InCheck(p);
 
   // INTERNAL ITERATIVE DEEPENING - we try to get a hash move to improve move ordering
+  // (nb. it uses the same stack entry, so pv has to be cleared afterwards)
 
-  if (!move && is_pv && depth >= 6 && !fl_check) {
-    Search(p, ply, alpha, beta, depth - 2, 0, 0, -1, PV_NODE, new_pv);
+  if (!move && is_pv && depth >= 6 * ONE_PLY && !fl_check) {
+    Stat(stats.iid++);
+    Search(p, ss, alpha, beta, depth - 2 * ONE_PLY, 0, 0, -1, PV_NODE);
     if (abort_search) return 0;
-    TransRetrieve(p->hash_key, &move, &score, alpha, beta, depth, ply);
+    TransRetrieve(p->hash_key, &move, &score, alpha, beta, depth / ONE_PLY, ply);
   }
 
-  if (!move && node_type == CUT_NODE && depth >= 6 && !fl_check) {
-    Search(p, ply, alpha, beta, depth - 4, 0, 0, -1, CUT_NODE, new_pv);
+  if (!move && node_type == CUT_NODE && depth >= 6 * ONE_PLY && !fl_check) {
+    Stat(stats.iid++);
+    Search(p, ss, alpha, beta, depth - 4 * ONE_PLY, 0, 0, -1, CUT_NODE);
     if (abort_search) return 0;
-    TransRetrieve(p->hash_key, &move, &score, alpha, beta, depth, ply);
+    TransRetrieve(p->hash_key, &move, &score, alpha, beta, depth / ONE_PLY, ply);
   }
+  ClearPv(ss);
 
   // Can we prune this node?
 
@@ -475,55 +669,70 @@ int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int la
   // for pruning/reduction decisions
 
   int eval = 0;
+  EvalProf(eval_prof.phase = PROF_SEARCH); // children of IID may have been in quiescence
   if (fl_prunable_node
-  && (!was_null || depth <= 6) ) eval = Eval.Return(p, &e, 1);
+  && (!was_null || depth <= 6 * ONE_PLY) ) eval = Eval.Return(p, &e, 1);
   
   //Correct self-side score by depth for human opponent
   if (fl_prunable_node){
 	  eval = Eval.EvalScaleByDepth(p,ply,eval);
   }
+  ss->eval = eval;
 
   // Beta pruning / static null move
 
   if (use_beta_pruning
   && fl_prunable_node
-  && depth <= 3                  // TODO: Tune me!
+  && depth <= 3 * ONE_PLY        // TODO: Tune me!
   && !was_null) {
-    int sc = eval - 120 * depth; // TODO: Tune me!
-    if (sc > beta) return sc;
+    int sc = eval - 120 * depth / ONE_PLY; // TODO: Tune me!
+    if (sc > beta) {
+      Stat(stats.beta_prunes++);
+      return sc;
+    }
   }
 
   // Null move
 
   if (use_nullmove
   && fl_prunable_node
-  && depth > 1
+  && depth > ONE_PLY
   && !was_null
   && MayNull(p)
   ) {
     if (eval > beta) {
 
-      new_depth = depth - ((823 + 67 * depth) / 256); // simplified Stockfish formula
+      new_depth = depth - ((823 + 67 * depth / ONE_PLY) / 256) * ONE_PLY; // simplified Stockfish formula
 
       // omit null move search if normal search to the same depth wouldn't exceed beta
       // (sometimes we can check it for free via hash table)
 
-      if (TransRetrieve(p->hash_key, &move, &null_score, alpha, beta, new_depth, ply)) {
+      if (TransRetrieve(p->hash_key, &move, &null_score, alpha, beta, new_depth / ONE_PLY, ply)) {
         if (null_score < beta) goto avoid_null;
       }
 
+      Stat(stats.null_tried++);
+      ss->move = 0;
+      ss->pc = NO_PC;
       p->DoNull(u);
-      if (new_depth > 0) score = -Search(p, ply + 1, -beta, -beta + 1, new_depth, 1, 0, -1, NEW_NODE(node_type), new_pv);
-      else               score = -QuiesceChecks(p, ply + 1, -beta, -beta + 1, new_pv);
+      if (new_depth > 0) score = -Search(p, ss + 1, -beta, -beta + 1, new_depth, 1, 0, -1, NEW_NODE(node_type));
+      else               score = -QuiesceChecks(p, ss + 1, -beta, -beta + 1);
       p->UndoNull(u);
 
       // Verification search (nb. immediate null move within it is prohibited)
 
-      if (new_depth > 6 && score >= beta && use_null_verification)
-         score = Search(p, ply, alpha, beta, new_depth - 5, 1, move, -1, CUT_NODE, new_pv);
+      if (new_depth > 6 * ONE_PLY && score >= beta && use_null_verification) {
+         Stat(stats.null_verified++);
+         score = Search(p, ss, alpha, beta, new_depth - 5 * ONE_PLY, 1, move, -1, CUT_NODE);
+         Stat(stats.verify_fails += (score < beta));
+      }
 
       if (abort_search ) return 0;
-      if (score >= beta) return score;
+      if (score >= beta) {
+        Stat(stats.null_cuts++);
+        return score;
+      }
+      ClearPv(ss);
     }
   } 
   
@@ -538,11 +747,16 @@ int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int la
   && !move
   && !was_null
   && !(p->Pawns(p->side) & bbRelRank[p->side][RANK_7]) // no pawns to promote in one move
-  && depth <= 4) {
-    int threshold = beta - razor_margin[depth];
+  && depth <= 4 * ONE_PLY) {
+    int threshold = beta - razor_margin[depth / ONE_PLY];
     if (eval < threshold) {
-      score = QuiesceChecks(p, ply, alpha, beta, pv);
-      if (score < threshold) return score;
+      Stat(stats.razor_tried++);
+      score = QuiesceChecks(p, ss, alpha, beta);
+      if (score < threshold) {
+        Stat(stats.razor_cuts++);
+        return score;
+      }
+      ClearPv(ss);
     }
   }
 
@@ -551,7 +765,7 @@ int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int la
   // Init moves and variables before entering main loop
   
   best = -INF;
-  InitMoves(p, m, move, Refutation(last_move), ply);
+  InitMoves(p, m, move, Refutation(last_move), ss);
   
   // Main loop
   
@@ -559,7 +773,7 @@ int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int la
 
     // Gather data about the move
 
-    mv_hist_score = history[p->pc[Fsq(move)]][Tsq(move)];
+    mv_hist_score = QuietHistory(p, move, ss);
 	victim = TpOnSq(p, Tsq(move));
 	if (victim != NO_TP) last_capt = Tsq(move);
 	else last_capt = -1;
@@ -570,13 +784,17 @@ int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int la
     && quiet_tried == 0) {
       if (use_futility
       && fl_prunable_node
-      && depth <= 6) {
-        if (eval + fut_margin[depth] < beta) fl_futility = 1;
+      && depth <= 6 * ONE_PLY) {
+        if (eval + fut_margin[depth / ONE_PLY] < beta) fl_futility = 1;
       }
     }
 
+    ss->move = move;
+    ss->pc = p->pc[Fsq(move)];
+    ss->tsq = Tsq(move);
+
     p->DoMove(move, u);
-    if (Illegal(p)) { p->UndoMove(move, u); continue; }
+    if (IllegalMove(p)) { p->UndoMove(move, u); continue; }
 
   // Update move statistics 
   // (needed for reduction/pruning decisions and for updating history score)
@@ -593,15 +811,15 @@ int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int la
   
   // Set new search depth
 
-  new_depth = depth - 1;
+  new_depth = depth - ONE_PLY;
 
   // Extensions (applied at pv node or at relatively low depth)
 
-  if (is_pv || depth < 9) {
-    new_depth += InCheck(p);                                // check extension, pv or low depth
-    if (is_pv && Tsq(move) == last_capt_sq) new_depth += 1; // recapture extension in pv
-    if (is_pv && depth < 6 && TpOnSq(p,Tsq(move)) == P      // pawn to 7th extension at the tips of pv
-    && (SqBb(Tsq(move)) & (RANK_2_BB | RANK_7_BB) ) ) new_depth += 1;
+  if (is_pv || depth < 9 * ONE_PLY) {
+    new_depth += InCheck(p) * ONE_PLY;                            // check extension, pv or low depth
+    if (is_pv && Tsq(move) == last_capt_sq) new_depth += ONE_PLY; // recapture extension in pv
+    if (is_pv && depth < 6 * ONE_PLY && TpOnSq(p,Tsq(move)) == P  // pawn to 7th extension at the tips of pv
+    && (SqBb(Tsq(move)) & (RANK_2_BB | RANK_7_BB) ) ) new_depth += ONE_PLY;
   }
 
   // Futility pruning
@@ -609,6 +827,7 @@ int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int la
   if (fl_futility
   &&  fl_prunable_move
   &&  mv_tried > 1) {
+    Stat(stats.fut_prunes++);
     p->UndoMove(move, u); continue;
   }
 
@@ -617,9 +836,10 @@ int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int la
   if (use_lmp
   && fl_prunable_node
   && fl_prunable_move
-  && quiet_tried > lmp_limit[depth]
-  && depth <= 3
+  && quiet_tried > lmp_limit[depth / ONE_PLY]
+  && depth <= 3 * ONE_PLY
   && MoveType(move) != CASTLE ) {
+    Stat(stats.lmp_prunes++);
     p->UndoMove(move, u); continue;
   }
 
@@ -628,41 +848,43 @@ int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int la
   reduction = 0;
 
   if (use_lmr 
-  && depth >= 2
+  && depth >= 2 * ONE_PLY
   && mv_tried > 3
   && alpha > -MAX_EVAL && beta < MAX_EVAL
   && !fl_check 
   &&  fl_prunable_move
-  && lmr_size[is_pv][depth][mv_tried] > 0
+  && lmr_size[is_pv][depth / ONE_PLY][Min(mv_tried, 63)] > 0
   && MoveType(move) != CASTLE ) {
     
     // read reduction size from the table
 
-    reduction = lmr_size[is_pv][depth][mv_tried];
+    reduction = lmr_size[is_pv][depth / ONE_PLY][Min(mv_tried, 63)];
 
     // increase reduction on bad history score
 
     if (mv_hist_score < 0
-    && new_depth - reduction > 2
+    && new_depth - reduction > 2 * ONE_PLY
     && lmr_hist_adjustement)
-       reduction++;
+       reduction += ONE_PLY;
 
     // reduce search depth
 
     new_depth -= reduction;
+    Stat(stats.lmr_reductions++);
   }
 
   if (use_lmr 
-  && depth >= 2
+  && depth >= 2 * ONE_PLY
   && mv_tried > 3
   && alpha > -MAX_EVAL && beta < MAX_EVAL
   && !fl_check 
   && !InCheck(p)
   && (fl_mv_type == MV_BADCAPT)
-  && lmr_size[is_pv][depth][mv_tried] > 0
+  && lmr_size[is_pv][depth / ONE_PLY][Min(mv_tried, 63)] > 0
   && !is_pv) {
-     reduction = 1;
+     reduction = ONE_PLY;
 	 new_depth -= reduction;
+     Stat(stats.lmr_reductions++);
   }
 
   // a place to come back if reduction scores above alpha
@@ -672,17 +894,18 @@ int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int la
   // PVS
 
   if (best == -INF)
-    score = -Search(p, ply + 1, -beta, -alpha, new_depth, 0, move, last_capt, NEW_NODE(node_type), new_pv);
+    score = -Search(p, ss + 1, -beta, -alpha, new_depth, 0, move, last_capt, NEW_NODE(node_type));
   else {
-    score = -Search(p, ply + 1, -alpha - 1, -alpha, new_depth, 0, move, last_capt, CUT_NODE, new_pv);
+    score = -Search(p, ss + 1, -alpha - 1, -alpha, new_depth, 0, move, last_capt, CUT_NODE);
     if (!abort_search && score > alpha && score < beta)
-      score = -Search(p, ply + 1, -beta, -alpha, new_depth, 0, move, last_capt, PV_NODE, new_pv);
+      score = -Search(p, ss + 1, -beta, -alpha, new_depth, 0, move, last_capt, PV_NODE);
   }
 
   // Reduced move scored above alpha - we need to re-search it
 
   if (reduction
   && score > alpha) {
+    Stat(stats.lmr_researches++);
     new_depth += reduction;
     reduction = 0;
 	if (node_type == ALL_NODE) node_type = CUT_NODE;
@@ -697,12 +920,15 @@ int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int la
   // Beta cutoff
 
     if (score >= beta) {
+      Stat(stats.cutoffs++);
+      Stat(stats.first_cutoffs += (mv_tried == 1));
+      Stat(stats.cutoff_index += mv_tried);
       if (!fl_check) {
-        UpdateHistory(p, last_move, move, depth, ply);
+        UpdateHistory(p, last_move, move, depth / ONE_PLY, ss);
         for (int mv = 0; mv < mv_tried; mv++)
-          DecreaseHistory(p, mv_played[mv], depth);
+          DecreaseHistory(p, mv_played[mv], depth / ONE_PLY, ss);
       }
-      TransStore(p->hash_key, move, score, LOWER, depth, ply);
+      TransStore(p->hash_key, move, score, LOWER, depth / ONE_PLY, ply);
 
       return score;
     }
@@ -713,7 +939,7 @@ int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int la
       best = score;
       if (score > alpha) {
         alpha = score;
-        BuildPv(pv, new_pv, move);
+        UpdatePv(ss, move);
       }
     }
 
@@ -728,13 +954,13 @@ int Search(POS *p, int ply, int alpha, int beta, int depth, int was_null, int la
 
   if (*pv) {
     if (!fl_check) {
-      UpdateHistory(p, last_move, *pv, depth, ply);
+      UpdateHistory(p, last_move, *pv, depth / ONE_PLY, ss);
       for (int mv = 0; mv < mv_tried; mv++)
-        DecreaseHistory(p, mv_played[mv], depth);
+        DecreaseHistory(p, mv_played[mv], depth / ONE_PLY, ss);
     }
-    TransStore(p->hash_key, *pv, best, EXACT, depth, ply);
+    TransStore(p->hash_key, *pv, best, EXACT, depth / ONE_PLY, ply);
   } else
-    TransStore(p->hash_key, 0, best, UPPER, depth, ply);
+    TransStore(p->hash_key, 0, best, UPPER, depth / ONE_PLY, ply);
 
   return best;
 }
@@ -763,13 +989,13 @@ int IsDraw(POS *p) {
       }
     }
 
-    // Trivially drawn KPK endgames
+    // Drawn KPK endgames, according to the bitbase
 
     if (p->PawnEndgame() ) {
       if (p->cnt[WC][P] + p->cnt[BC][P] == 1) {
 
-        if (p->cnt[WC][P] == 1 ) return KPKdraw(p, WC); // exactly one white pawn
-        if (p->cnt[BC][P] == 1 ) return KPKdraw(p, BC); // exactly one black pawn
+        if (p->cnt[WC][P] == 1 ) return !Kpk.Win(p, WC); // exactly one white pawn
+        if (p->cnt[BC][P] == 1 ) return !Kpk.Win(p, BC); // exactly one black pawn
       }
     } // pawns only
   }
@@ -778,39 +1004,6 @@ int IsDraw(POS *p) {
   return 0; // default: no draw
 }
 
-int KPKdraw(POS *p, int sd) {
-
-  int op = Opp(sd);
-  U64 bbPawn = p->Pawns(sd);
-  U64 bbStrongKing = p->Kings(sd);
-  U64 bbWeakKing = p->Kings(op);
-
-  // opposition through a pawn
-
-  if (p->side == sd
-  && (bbWeakKing & BB.ShiftFwd(bbPawn, sd))
-  && (bbStrongKing & BB.ShiftFwd(bbPawn, op))
-  ) return 1;
-  
-  // weaker side can create opposition through a pawn in one move
-
-  if (p->side == op
-  && (BB.KingAttacks(p->king_sq[op]) & BB.ShiftFwd(bbPawn, sd))
-  && (bbStrongKing & BB.ShiftFwd(bbPawn, op))
-  ) if (!Illegal(p)) return 1;
-
-  // opposition next to a pawn
-  
-  if (p->side == sd
-  && (bbStrongKing & BB.ShiftSideways(bbPawn))
-  && (bbWeakKing & BB.ShiftFwd(BB.ShiftFwd(bbStrongKing,sd) ,sd)) 
-  ) return 1;
-
-  // TODO: pawn checks king
-
-  return 0;
-}
-
 void DisplayCurrmove(int move, int tried) {
 
   printf("info currmove ");
@@ -823,16 +1016,16 @@ void DisplaySpeed(void) {
   int elapsed = Timer.GetElapsedTime();
   U64 nps = GetNps(elapsed);
 #if defined _WIN32 || defined _WIN64 
-  printf("info time %d nodes %I64d nps %I64d \n", elapsed, nodes, nps);
+  printf("info time %d nodes %I64d nps %I64d tbhits %I64d \n", elapsed, nodes, nps, tb_hits);
 #else
-  printf("info time %d nodes %lld nps %lld \n", elapsed, nodes, nps);
+  printf("info time %d nodes %lld nps %lld tbhits %lld \n", elapsed, nodes, nps, tb_hits);
 #endif
   
 }
 
-void DisplayPv(int score, int *pv) {
+void DisplayPv(int score, int *pv, int line) {
 
-  char *type, pv_str[512];
+  char *type, pv_str[512], line_str[20];
   int elapsed = Timer.GetElapsedTime();
   U64 nps = GetNps(elapsed);
 
@@ -844,16 +1037,27 @@ void DisplayPv(int score, int *pv) {
   else
     type = "cp";
 
+  // In multi-pv mode each line is tagged with its number
+
+  line_str[0] = '\0';
+  if (line) sprintf(line_str, " multipv %d", line);
+
   PvToStr(pv, pv_str);
 #if defined _WIN32 || defined _WIN64 
-  printf("info depth %d time %d nodes %I64d nps %I64d score %s %d pv %s\n",
-      root_depth, elapsed, nodes, nps, type, score, pv_str);
+  printf("info depth %d%s time %d nodes %I64d nps %I64d tbhits %I64d score %s %d pv %s\n",
+      root_depth, line_str, elapsed, nodes, nps, tb_hits, type, score, pv_str);
 #else
-  printf("info depth %d time %d nodes %lld nps %lld score %s %d pv %s\n",
-      root_depth, elapsed, nodes, nps, type, score, pv_str);
+  printf("info depth %d%s time %d nodes %lld nps %lld tbhits %lld score %s %d pv %s\n",
+      root_depth, line_str, elapsed, nodes, nps, tb_hits, type, score, pv_str);
 #endif
 }
 
+void DisplayMultiPv(int lines) {
+
+  for (int i = 0; i < lines; i++)
+    DisplayPv(root_list.moves[i].score, root_list.moves[i].pv, i + 1);
+}
+
 void CheckTimeout(void) {
 
   char command[80];
@@ -898,7 +1102,7 @@ void CheckTimeout(void) {
 
   // Process commands that might terminate the search
 
-  if (InputAvailable()) {
+  if (fl_poll_input && InputAvailable()) {
     ReadLine(command, sizeof(command));
 
     if (strcmp(command, "stop") == 0)
@@ -907,6 +1111,10 @@ void CheckTimeout(void) {
       pondering = 0;
   }
 
+  // Helper processes are stopped by the front end (see procs.cpp)
+
+  if (ProcsStopped()) abort_search = 1;
+
   // Have we already used our allocated time?
 
   if (Timeout()) abort_search = 1;
@@ -929,3 +1137,16 @@ int DrawScore(POS * p) {
   if (p->side == root_side) return -Param.draw_score;
   else                      return  Param.draw_score;
 }
+
+void SortRootListByNodes(ROOT_LIST *rl, int first) {
+
+  for (int i = first + 1; i < rl->cnt; i++) {
+    ROOT_MOVE tmp = rl->moves[i];
+    int j = i - 1;
+    while (j >= first && rl->moves[j].prev_nodes < tmp.prev_nodes) {
+      rl->moves[j + 1] = rl->moves[j];
+      j--;
+    }
+    rl->moves[j + 1] = tmp;
+  }
+}
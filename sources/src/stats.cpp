@@ -0,0 +1,139 @@
+/*
+Rodent, a UCI chess playing engine derived from Sungorus 1.4
+Copyright (C) 2009-2011 Pablo Vazquez (Sungorus author)
+Copyright (C) 2011-2016 Pawel Koziol
+
+Rodent is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published
+by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+Rodent is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Search statistics, meant as a help in tuning pruning and reduction
+// parameters. Counters are updated by Stat() macros in Search() and
+// QuiesceChecks(), which are compiled only by "make build-stats"
+// (defining USE_SEARCH_STATS). They are cleared at the start of each
+// search and of bench, and shown by the "stats" command.
+//
+// Evaluation profile is gathered by "make build-evalprof" (defining
+// USE_EVAL_PROFILE) and printed after each search and after bench.
+
+#include <stdio.h>
+#include <string.h>
+#include "rodent.h"
+
+#if defined(USE_SEARCH_STATS) || defined(USE_EVAL_PROFILE)
+static double Percent(U64 part, U64 total) {
+  return total ? 100.0 * part / total : 0.0;
+}
+#endif
+
+#ifdef USE_SEARCH_STATS
+
+SEARCH_STATS stats;
+
+void ClearSearchStats(void) {
+  memset(&stats, 0, sizeof(stats));
+}
+
+void PrintSearchStats(void) {
+
+#if defined _WIN32 || defined _WIN64
+#define U64_FMT "%12I64u"
+#else
+#define U64_FMT "%12llu"
+#endif
+
+  printf("Search statistics:\n");
+  printf("nodes            " U64_FMT "\n", stats.nodes);
+  printf("iid              " U64_FMT "\n", stats.iid);
+  printf("beta pruning     " U64_FMT "\n", stats.beta_prunes);
+  printf("null move tried  " U64_FMT "  cutoffs %5.1f%%\n", stats.null_tried, Percent(stats.null_cuts, stats.null_tried));
+  printf("null verified    " U64_FMT "  failed  %5.1f%%\n", stats.null_verified, Percent(stats.verify_fails, stats.null_verified));
+  printf("razoring tried   " U64_FMT "  cutoffs %5.1f%%\n", stats.razor_tried, Percent(stats.razor_cuts, stats.razor_tried));
+  printf("futility prunes  " U64_FMT "\n", stats.fut_prunes);
+  printf("lmp prunes       " U64_FMT "\n", stats.lmp_prunes);
+  printf("lmr reductions   " U64_FMT "  re-searched %5.1f%%\n", stats.lmr_reductions, Percent(stats.lmr_researches, stats.lmr_reductions));
+  printf("beta cutoffs     " U64_FMT "  first move %5.1f%%, average index %.2f\n", stats.cutoffs,
+         Percent(stats.first_cutoffs, stats.cutoffs), stats.cutoffs ? (double)stats.cutoff_index / stats.cutoffs : 0.0);
+  printf("qs check nodes   " U64_FMT "  stand pat %5.1f%%, hash %5.1f%%, cutoffs %5.1f%%\n", stats.qc_nodes,
+         Percent(stats.qc_stand_pat, stats.qc_nodes), Percent(stats.qc_tt_cuts, stats.qc_nodes), Percent(stats.qc_cutoffs, stats.qc_nodes));
+  printf("hash cutoffs by depth:\n");
+  for (int d = 1; d < MAX_PLY; d++)
+    if (stats.tt_probes[d])
+      printf("  depth %2d       " U64_FMT "  probes, cutoffs %5.1f%%\n", d, stats.tt_probes[d], Percent(stats.tt_cuts[d], stats.tt_probes[d]));
+
+#undef U64_FMT
+}
+
+#else
+
+void ClearSearchStats(void) {
+}
+
+void PrintSearchStats(void) {
+  printf("info string search statistics are not compiled in (use make build-stats)\n");
+}
+
+#endif
+
+#ifdef USE_EVAL_PROFILE
+
+EVAL_PROFILE eval_prof;
+
+void ClearEvalProfile(void) {
+  memset(&eval_prof, 0, sizeof(eval_prof));
+}
+
+void PrintEvalProfile(void) {
+
+  static const char *stage_name[N_OF_PROF_STAGES] = {
+    "init", "ScoreMaterial", "ScorePieces", "FullPawnEval", "ScoreHanging",
+    "ScorePatterns", "ScorePassers", "ScoreUnstoppable", "final"
+  };
+  static const char *phase_name[2] = { "search", "quiesce" };
+  U64 total = 0;
+
+#if defined _WIN32 || defined _WIN64
+#define U64_FMT "%12I64u"
+#else
+#define U64_FMT "%12llu"
+#endif
+
+  for (int ph = 0; ph < 2; ph++)
+    printf("info string eval %-8s calls " U64_FMT ", eval hash %5.1f%%, pawn hash %5.1f%%\n", phase_name[ph],
+           eval_prof.calls[ph], Percent(eval_prof.hash_hits[ph], eval_prof.calls[ph]),
+           Percent(eval_prof.pawn_hits[ph], eval_prof.pawn_probes[ph]));
+
+  U64 full = eval_prof.calls[PROF_SEARCH] + eval_prof.calls[PROF_QS]
+           - eval_prof.hash_hits[PROF_SEARCH] - eval_prof.hash_hits[PROF_QS];
+
+  for (int st = 0; st < N_OF_PROF_STAGES; st++)
+    total += eval_prof.cycles[st];
+
+  for (int st = 0; st < N_OF_PROF_STAGES; st++)
+    printf("info string eval %-16s cycles " U64_FMT " (%5.1f%%), %7.1f per full eval\n", stage_name[st],
+           eval_prof.cycles[st], Percent(eval_prof.cycles[st], total), full ? (double)eval_prof.cycles[st] / full : 0.0);
+
+  printf("info string eval total            cycles " U64_FMT ", %7.1f per full eval\n", total, full ? (double)total / full : 0.0);
+
+#undef U64_FMT
+}
+
+#else
+
+void ClearEvalProfile(void) {
+}
+
+void PrintEvalProfile(void) {
+}
+
+#endif
@@ -56,3 +56,86 @@ int Swap(POS *p, int from, int to) {
     score[ply - 1] = -Max(-score[ply - 1], score[ply]);
   return score[0];
 }
+
+// @SeeGE() tells whether static exchange evaluation of a move reaches
+// the threshold. Unlike Swap(), it stops as soon as the outcome is known.
+// If check info of the current node is given, pieces of side to move
+// pinned to their king take part only when the pin line leads to the
+// target square.
+
+int SeeGE(POS *p, int move, int threshold, CHECK_INFO *ci) {
+
+  int from = Fsq(move);
+  int to = Tsq(move);
+  int side = Cl(p->pc[from]);
+  int result = 1;
+  U64 bbOcc, bbAttackers, bbOwn, bbType, bbPinned = 0;
+
+  // Capture alone doesn't reach the threshold
+
+  int swap = tp_value[TpOnSq(p, to)] - threshold;
+  if (swap < 0) return 0;
+
+  // Even losing the capturing piece for nothing keeps us above it
+
+  swap = tp_value[TpOnSq(p, from)] - swap;
+  if (swap <= 0) return 1;
+
+  if (ci && ci->bbPinned) {
+    int ksq = KingSq(p, p->side);
+    U64 bb = ci->bbPinned;
+    while (bb) {
+      int sq = BB.PopFirstBit(&bb);
+      if (!(BB.Between(ksq, to) & SqBb(sq)) && !(BB.Between(ksq, sq) & SqBb(to)))
+        bbPinned |= SqBb(sq);
+    }
+  }
+
+  bbOcc = OccBb(p) ^ SqBb(from) ^ SqBb(to);
+  bbAttackers = AttacksTo(p, to)
+              | (BB.BishAttacks(bbOcc, to) & (p->tp_bb[B] | p->tp_bb[Q]))
+              | (BB.RookAttacks(bbOcc, to) & (p->tp_bb[R] | p->tp_bb[Q]));
+
+  for (;;) {
+    side ^= 1;
+    bbAttackers &= bbOcc;
+    bbOwn = bbAttackers & p->cl_bb[side];
+    if (side == p->side) bbOwn &= ~bbPinned;
+    if (!bbOwn) break;
+
+    result ^= 1;
+
+    // Capture with the least valuable attacker. Each time the
+    // exchange would be decided in favour of the side to move,
+    // we may stop. Captures uncover sliders behind the piece.
+
+    if ((bbType = bbOwn & p->tp_bb[P])) {
+      if ((swap = tp_value[P] - swap) < result) break;
+      bbOcc ^= bbType & -bbType;
+      bbAttackers |= BB.BishAttacks(bbOcc, to) & (p->tp_bb[B] | p->tp_bb[Q]);
+    } else if ((bbType = bbOwn & p->tp_bb[N])) {
+      if ((swap = tp_value[N] - swap) < result) break;
+      bbOcc ^= bbType & -bbType;
+    } else if ((bbType = bbOwn & p->tp_bb[B])) {
+      if ((swap = tp_value[B] - swap) < result) break;
+      bbOcc ^= bbType & -bbType;
+      bbAttackers |= BB.BishAttacks(bbOcc, to) & (p->tp_bb[B] | p->tp_bb[Q]);
+    } else if ((bbType = bbOwn & p->tp_bb[R])) {
+      if ((swap = tp_value[R] - swap) < result) break;
+      bbOcc ^= bbType & -bbType;
+      bbAttackers |= BB.RookAttacks(bbOcc, to) & (p->tp_bb[R] | p->tp_bb[Q]);
+    } else if ((bbType = bbOwn & p->tp_bb[Q])) {
+      if ((swap = tp_value[Q] - swap) < result) break;
+      bbOcc ^= bbType & -bbType;
+      bbAttackers |= (BB.BishAttacks(bbOcc, to) & (p->tp_bb[B] | p->tp_bb[Q]))
+                   | (BB.RookAttacks(bbOcc, to) & (p->tp_bb[R] | p->tp_bb[Q]));
+    } else {
+
+      // King can capture only if there are no more defenders
+
+      return (bbAttackers & ~p->cl_bb[side] & bbOcc) ? result ^ 1 : result;
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,179 @@
+/*
+Rodent, a UCI chess playing engine derived from Sungorus 1.4
+Copyright (C) 2009-2011 Pablo Vazquez (Sungorus author)
+Copyright (C) 2011-2016 Pawel Koziol
+
+Rodent is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published
+by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+Rodent is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Interface to Syzygy endgame tablebases. Probing itself is done by
+// Fathom library (https://github.com/jdart1/Fathom), which memory-maps
+// table files and is safe to call from many threads. Its sources are
+// fetched into src/fathom/ by "make fathom" and are compiled only by
+// "make build-syzygy", which defines USE_SYZYGY. Without it, all probes
+// simply fail.
+
+#include <stdio.h>
+#include <string.h>
+#include "rodent.h"
+
+#ifdef USE_SYZYGY
+#include "fathom/tbprobe.h"
+#endif
+
+int tb_largest;      // largest number of pieces in available tables
+int tb_probe_depth;  // minimal depth for probing within search
+int tb_probe_limit;  // maximal number of pieces for probing (user-defined)
+U64 tb_hits;
+
+#ifdef USE_SYZYGY
+
+void TbInit(char *path) {
+
+  tb_free();
+  tb_largest = 0;
+
+  if (!path[0] || strcmp(path, "<empty>") == 0) return;
+
+  if (!tb_init(path)) {
+    printf("info string cannot initialize Syzygy tablebases in %s\n", path);
+    return;
+  }
+
+  tb_largest = TB_LARGEST;
+  if (tb_largest) printf("info string found %d-piece Syzygy tablebases\n", tb_largest);
+  else            printf("info string no Syzygy tablebases found in %s\n", path);
+}
+
+int TbProbeWdl(POS *p, int ply, int *score) {
+
+  // Probe only positions with few pieces, right after a capture or a pawn move
+
+  if (!tb_largest
+  || p->rev_moves != 0
+  || p->castle_flags
+  || BB.PopCnt(OccBb(p)) > Min(tb_largest, tb_probe_limit))
+    return NONE;
+
+  unsigned result = tb_probe_wdl(p->cl_bb[WC], p->cl_bb[BC],
+                                 p->tp_bb[K], p->tp_bb[Q], p->tp_bb[R],
+                                 p->tp_bb[B], p->tp_bb[N], p->tp_bb[P],
+                                 0, 0, p->ep_sq == NO_SQ ? 0 : p->ep_sq,
+                                 p->side == WC);
+
+  if (result == TB_RESULT_FAILED) return NONE;
+
+  tb_hits++;
+
+  // Wins and losses are scored below mate scores, so that the search
+  // prefers converting to a shorter win. Wins spoiled by 50-move rule
+  // are scored as draws, slightly better than a real draw.
+
+  switch (result) {
+  case TB_WIN:          *score = TB_WIN_SCORE - ply;  return LOWER;
+  case TB_LOSS:         *score = -TB_WIN_SCORE + ply; return UPPER;
+  case TB_CURSED_WIN:   *score = DrawScore(p) + 1;   return EXACT;
+  case TB_BLESSED_LOSS: *score = DrawScore(p) - 1;   return EXACT;
+  }
+
+  *score = DrawScore(p);
+  return EXACT;
+}
+
+void TbFilterRootMoves(POS *p, ROOT_LIST *rl) {
+
+  unsigned results[TB_MAX_MOVES];
+  int wdl[MAX_MOVES], dtz[MAX_MOVES];
+  int best_wdl = -1, cnt = 0;
+
+  if (!tb_largest
+  || p->castle_flags
+  || BB.PopCnt(OccBb(p)) > Min(tb_largest, tb_probe_limit))
+    return;
+
+  unsigned result = tb_probe_root(p->cl_bb[WC], p->cl_bb[BC],
+                                  p->tp_bb[K], p->tp_bb[Q], p->tp_bb[R],
+                                  p->tp_bb[B], p->tp_bb[N], p->tp_bb[P],
+                                  p->rev_moves, 0, p->ep_sq == NO_SQ ? 0 : p->ep_sq,
+                                  p->side == WC, results);
+
+  if (result == TB_RESULT_FAILED
+  ||  result == TB_RESULT_CHECKMATE
+  ||  result == TB_RESULT_STALEMATE)
+    return;
+
+  tb_hits++;
+
+  // Find distance-to-zero result for each root move
+
+  for (int i = 0; i < rl->cnt; i++) {
+    int move = rl->moves[i].move;
+    wdl[i] = -1;
+    dtz[i] = 0;
+
+    for (int j = 0; results[j] != TB_RESULT_FAILED; j++) {
+      int prom = TB_GET_PROMOTES(results[j]);
+      if ((int)TB_GET_FROM(results[j]) != Fsq(move)
+      ||  (int)TB_GET_TO(results[j]) != Tsq(move))
+        continue;
+      if (IsProm(move) != 0 && (prom == TB_PROMOTES_NONE || 5 - prom != PromType(move)))
+        continue;
+      wdl[i] = TB_GET_WDL(results[j]);
+      dtz[i] = TB_GET_DTZ(results[j]);
+      break;
+    }
+    best_wdl = Max(best_wdl, wdl[i]);
+  }
+
+  // Keep only the moves preserving the best result. Winning moves
+  // are ordered by distance to zeroing move, so that we make progress.
+
+  for (int i = 0; i < rl->cnt; i++) {
+    if (wdl[i] != best_wdl) continue;
+    rl->moves[cnt] = rl->moves[i];
+    dtz[cnt] = dtz[i];
+    cnt++;
+  }
+  rl->cnt = cnt;
+
+  if (best_wdl == TB_WIN) {
+    for (int i = 1; i < cnt; i++) {
+      ROOT_MOVE tmp = rl->moves[i];
+      int tmp_dtz = dtz[i];
+      int j = i - 1;
+      while (j >= 0 && dtz[j] > tmp_dtz) {
+        rl->moves[j + 1] = rl->moves[j];
+        dtz[j + 1] = dtz[j];
+        j--;
+      }
+      rl->moves[j + 1] = tmp;
+      dtz[j + 1] = tmp_dtz;
+    }
+  }
+}
+
+#else
+
+void TbInit(char *) {
+  tb_largest = 0;
+}
+
+int TbProbeWdl(POS *, int, int *) {
+  return NONE;
+}
+
+void TbFilterRootMoves(POS *, ROOT_LIST *) {
+}
+
+#endif
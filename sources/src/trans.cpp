@@ -8,8 +8,12 @@ void AllocTrans(int mbsize) {
   tt_size = ((tt_size / 2) << 20) / sizeof(ENTRY);
   tt_mask = tt_size - 4;
   free(tt);
-  tt = (ENTRY *) malloc(tt_size * sizeof(ENTRY));
-  ClearTrans();
+
+  // calloc() returns zeroed memory, which the system maps only when it is
+  // first written to, so a table that is not used costs nothing
+
+  tt = (ENTRY *) calloc(tt_size, sizeof(ENTRY));
+  tt_date = 0;
 }
 
 void ClearTrans(void) {
@@ -24,43 +28,17 @@ void ClearTrans(void) {
     entry->flags = 0;
     entry->depth = 0;
   }
+  ProcsClearTrans();
 }
 
-int TransRetrieve(U64 key, int *move, int *score, int alpha, int beta, int depth, int ply) {
-  ENTRY *entry;
-
-  entry = tt + (key & tt_mask);
-  for (int i = 0; i < 4; i++) {
-    if (entry->key == key) {
-      entry->date = tt_date;
-      *move = entry->move;
-      if (entry->depth >= depth) {
-        *score = entry->score;
-        if (*score < -MAX_EVAL)
-          *score += ply;
-        else if (*score > MAX_EVAL)
-          *score -= ply;
-        if ((entry->flags & UPPER && *score <= alpha) ||
-            (entry->flags & LOWER && *score >= beta))
-          return 1;
-      }
-      break;
-    }
-    entry++;
-  }
-  return 0;
-}
+// @StoreEntry() writes an entry, replacing the same position or the oldest
+// and shallowest entry of a bucket
 
-void TransStore(U64 key, int move, int score, int flags, int depth, int ply) {
+static ENTRY *StoreEntry(U64 key, int move, int score, int flags, int depth) {
 
   ENTRY *entry, *replace;
   int i, oldest, age;
 
-  if (score < -MAX_EVAL)
-    score -= ply;
-  else if (score > MAX_EVAL)
-    score += ply;
-
   replace = NULL;
   oldest = -1;
   entry = tt + (key & tt_mask);
@@ -79,4 +57,59 @@ void TransStore(U64 key, int move, int score, int flags, int depth, int ply) {
   }
   replace->key = key; replace->date = tt_date; replace->move = move;
   replace->score = score; replace->flags = flags; replace->depth = depth;
+  return replace;
+}
+
+// @ImportShared() copies a deep entry found by another search process
+// into the local table, so that it is probed only once
+
+static ENTRY *ImportShared(U64 key, int depth) {
+
+  int move, score, flags;
+
+  if (!ProcsTransRetrieve(key, &move, &score, &flags, &depth)) return NULL;
+  return StoreEntry(key, move, score, flags, depth);
+}
+
+int TransRetrieve(U64 key, int *move, int *score, int alpha, int beta, int depth, int ply) {
+  ENTRY *entry, *found = NULL;
+
+  entry = tt + (key & tt_mask);
+  for (int i = 0; i < 4; i++) {
+    if (entry->key == key) {
+      found = entry;
+      break;
+    }
+    entry++;
+  }
+
+  if (!found && procs_cnt > 1) found = ImportShared(key, depth);
+  if (!found) return 0;
+
+  found->date = tt_date;
+  *move = found->move;
+  if (found->depth >= depth) {
+    *score = found->score;
+    if (*score < -MAX_EVAL)
+      *score += ply;
+    else if (*score > MAX_EVAL)
+      *score -= ply;
+    if ((found->flags & UPPER && *score <= alpha) ||
+        (found->flags & LOWER && *score >= beta))
+      return 1;
+  }
+  return 0;
+}
+
+void TransStore(U64 key, int move, int score, int flags, int depth, int ply) {
+
+  ENTRY *entry;
+
+  if (score < -MAX_EVAL)
+    score -= ply;
+  else if (score > MAX_EVAL)
+    score += ply;
+
+  entry = StoreEntry(key, move, score, flags, depth);
+  if (procs_cnt > 1) ProcsTransStore(key, entry->move, score, flags, depth);
 }
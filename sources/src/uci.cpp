@@ -51,6 +51,16 @@ void UciLoop(void) {
       printf("id author Pawel Koziol (based on Sungorus 1.4 by Pablo Vazquez)\n");
       printf("option name Hash type spin default 16 min 1 max 4096\n");
       printf("option name Clear Hash type button\n");
+      printf("option name MultiPV type spin default 1 min 1 max %d\n", MAX_MOVES);
+#ifdef USE_PROCS
+      printf("option name Processes type spin default 1 min 1 max %d\n", MAX_PROCS);
+      printf("option name NumaAffinity type check default true\n");
+#endif
+#ifdef USE_SYZYGY
+      printf("option name SyzygyPath type string default <empty>\n");
+      printf("option name SyzygyProbeDepth type spin default %d min 1 max 100\n", tb_probe_depth);
+      printf("option name SyzygyProbeLimit type spin default %d min 0 max 7\n", tb_probe_limit);
+#endif
       if (panel_style > 0) {
         printf("option name PawnValue type spin default %d min 0 max 1200\n", Param.pc_value[P]);
         printf("option name KnightValue type spin default %d min 0 max 1200\n", Param.pc_value[N]);
@@ -142,32 +152,42 @@ void UciLoop(void) {
       printf("readyok\n");
     } else if (strcmp(token, "setoption") == 0) {
       ParseSetoption(ptr);
+      ProcsForward(command);
     } else if (strcmp(token, "position") == 0) {
       ParsePosition(p, ptr);
+      ProcsForward(command);
     } else if (strcmp(token, "perft") == 0) {
-      ptr = ParseToken(ptr, token);
-    int depth = atoi(token);
-    if (depth == 0) depth = 5;
-    Timer.SetStartTime();
-    nodes = Perft(p, 0, depth);
-#if defined _WIN32 || defined _WIN64 
-    printf (" perft %d : %I64d nodes in %d miliseconds\n", depth, nodes, Timer.GetElapsedTime() );
-#else
-    printf(" perft %d : %lld nodes in %d miliseconds\n", depth, nodes, Timer.GetElapsedTime());
-#endif
+      ParsePerft(p, ptr, 0);
+    } else if (strcmp(token, "divide") == 0) {
+      ParsePerft(p, ptr, 1);
+    } else if (strcmp(token, "perfttest") == 0) {
+      PerftTest(ptr);
     } else if (strcmp(token, "print") == 0) {
       PrintBoard(p);
     } else if (strcmp(token, "eval") == 0) {
       SetAsymmetricEval(p->side);
+      fl_tables_used = 1;
       Eval.Print(p);
     } else if (strcmp(token, "step") == 0) {
       ParseMoves(p, ptr);
+      ProcsForward(command);
     } else if (strcmp(token, "go") == 0) {
       ParseGo(p, ptr);
     } else if (strcmp(token, "bench") == 0) {
+      Bench(ptr);
+    } else if (strcmp(token, "pvbench") == 0) {
       ptr = ParseToken(ptr, token);
-      Bench(atoi(token));
+      BenchPv(atoi(token));
+    } else if (strcmp(token, "microbench") == 0) {
+      MicroBench(ptr);
+    } else if (strcmp(token, "stats") == 0) {
+      PrintSearchStats();
+    } else if (strcmp(token, "procstest") == 0) {
+      ProcsTest(ptr);
+    } else if (strcmp(token, "kpktest") == 0) {
+      Kpk.Verify();
     } else if (strcmp(token, "quit") == 0) {
+      ProcsSet(1);
       return;
     }
   }
@@ -202,6 +222,20 @@ void ParseSetoption(char *ptr) {
 
   if (strcmp(name, "Hash") == 0) {
     AllocTrans(atoi(value));
+  } else if (strcmp(name, "Processes") == 0) {
+    ProcsSet(atoi(value));
+  } else if (strcmp(name, "NumaAffinity") == 0) {
+    ProcsSetAffinity(strcmp(value, "true") == 0);
+  } else if (strcmp(name, "MultiPV") == 0 || strcmp(name, "multipv") == 0) {
+    multi_pv = atoi(value);
+    if (multi_pv < 1) multi_pv = 1;
+    if (multi_pv > MAX_MOVES) multi_pv = MAX_MOVES;
+  } else if (strcmp(name, "SyzygyPath") == 0 || strcmp(name, "syzygypath") == 0) {
+    TbInit(value);
+  } else if (strcmp(name, "SyzygyProbeDepth") == 0 || strcmp(name, "syzygyprobedepth") == 0) {
+    tb_probe_depth = atoi(value);
+  } else if (strcmp(name, "SyzygyProbeLimit") == 0 || strcmp(name, "syzygyprobelimit") == 0) {
+    tb_probe_limit = atoi(value);
   } else if (strcmp(name, "Clear Hash") == 0 || strcmp(name, "clear hash") == 0) {
     ResetEngine();
   } else if (strcmp(name, "Material") == 0 || strcmp(name, "material") == 0) {
@@ -417,15 +451,33 @@ void ParsePosition(POS *p, char *ptr) {
 void ParseGo(POS *p, char *ptr) {
 
   char token[180], bestmove_str[6], ponder_str[6];
+  char *go_args = ptr;
   int pv[MAX_PLY];
 
+  int fl_search_moves = 0;
+
   Timer.Clear();
   pondering = 0;
+  search_moves_cnt = 0;
 
   for (;;) {
     ptr = ParseToken(ptr, token);
     if (*token == '\0')
       break;
+    if (strcmp(token, "searchmoves") == 0) {
+      fl_search_moves = 1;
+      continue;
+    }
+
+    // Moves restricting the search are listed until the next keyword
+
+    if (fl_search_moves && IsMoveStr(token)) {
+      if (search_moves_cnt < MAX_MOVES)
+        search_moves[search_moves_cnt++] = StrToMove(p, token);
+      continue;
+    }
+    fl_search_moves = 0;
+
     if (strcmp(token, "ponder") == 0) {
       pondering = 1;
     } else if (strcmp(token, "wtime") == 0) {
@@ -461,7 +513,9 @@ void ParseGo(POS *p, char *ptr) {
 
   Timer.SetSideData(p->side);
   Timer.SetMoveTiming();
+  ProcsGo(go_args);
   Think(p, pv);
+  ProcsStop(p, pv);
   MoveToStr(pv[0], bestmove_str);
   if (pv[1]) {
     MoveToStr(pv[1], ponder_str);
@@ -472,6 +526,12 @@ void ParseGo(POS *p, char *ptr) {
 
 void ResetEngine(void) {
 
+  // Tables nothing has written to since they were cleared are left alone.
+  // At startup this saves time and keeps their pages from being allocated.
+
+  if (!fl_tables_used) return;
+  fl_tables_used = 0;
+
   ClearHist();
   ClearTrans();
   ClearEvalHash();
@@ -514,30 +574,6 @@ void ReadPersonality(char *fileName)
   fl_reading_personality = 0;
 }
 
-int Perft(POS *p, int ply, int depth) {
-
-  int move = 0;
-  int fl_mv_type;
-  MOVES m[1];
-  UNDO u[1];
-  int mv_cnt = 0;
-
-  InitMoves(p, m, 0, 0, ply);
-
-  while (move = NextMove(m, &fl_mv_type)) {
-
-  p->DoMove(move, u);
-
-  if (Illegal(p)) { p->UndoMove(move, u); continue; }
-
-  if (depth == 1) mv_cnt++;
-    else          mv_cnt += Perft(p, ply + 1, depth - 1);
-    p->UndoMove(move, u);
-  }
-
-  return mv_cnt;
-}
-
 void PrintBoard(POS *p) {
 
   char *piece_name[] = { "P ", "p ", "N ", "n ", "B ", "b ", "R ", "r ", "Q ", "q ", "K ", "k ", ". " };
@@ -550,51 +586,3 @@ void PrintBoard(POS *p) {
 
   printf("\na b c d e f g h\n\n--------------------------------------------\n");
 }
-
-void Bench(int depth) {
-
-  POS p[1];
-  int pv[MAX_PLY];
-  char *test[] = {
-    "r1bqkbnr/pp1ppppp/2n5/2p5/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq -",
-    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
-    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -",
-    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
-    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
-    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
-    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
-    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
-    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
-    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
-    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
-    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
-    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
-    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
-    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
-    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
-    NULL
-  }; // test positions taken from DiscoCheck by Lucas Braesch
-
-  if (depth == 0) depth = 8; // so that you can call bench without parameters
-
-  printf("Bench test started (depth %d): \n", depth);
-
-  ResetEngine();
-  nodes = 0;
-  verbose = 0;
-  Timer.SetData(MAX_DEPTH, depth);
-  Timer.SetData(FLAG_INFINITE, 1);
-  Timer.SetStartTime();
-
-  for (int i = 0; test[i]; ++i) {
-    printf(test[i]);
-    SetPosition(p, test[i]);
-    printf("\n");
-    Iterate(p, pv);
-  }
-
-  int end_time = Timer.GetElapsedTime();
-  int nps = (nodes * 1000) / (end_time + 1);
-
-  printf("%llu nodes searched in %d, speed %u nps (Score: %.3f)\n", nodes, end_time, nps, (float)nps / 430914.0);
-}
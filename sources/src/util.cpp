@@ -7,6 +7,7 @@
 #  include <sys/time.h>
 #endif
 #include "rodent.h"
+#include "timer.h"
 
 U64 POS::Pawns(int sd) {
    return (cl_bb[sd] & tp_bb[P]);
@@ -81,26 +82,18 @@ int InputAvailable(void) {
 #endif
 }
 
-U64 Random64(void) {
-
-  static U64 next = 1;
-
-  next = next * 1103515245 + 12345;
-  return next;
-}
-
 U64 InitHashKey(POS *p) {
 
   U64 key = 0;
 
   for (int i = 0; i < 64; i++)
     if (p->pc[i] != NO_PC)
-      key ^= zob_piece[p->pc[i]][i];
+      key ^= Zob.piece[p->pc[i]][i];
 
-  key ^= zob_castle[p->castle_flags];
+  key ^= Zob.castle[p->castle_flags];
   
   if (p->ep_sq != NO_SQ)
-    key ^= zob_ep[File(p->ep_sq)];
+    key ^= Zob.ep[File(p->ep_sq)];
 
   if (p->side == BC)
     key ^= SIDE_RANDOM;
@@ -113,7 +106,7 @@ U64 InitPawnKey(POS *p) {
 
   for (int i = 0; i < 64; i++) {
     if ((p->tp_bb[P] & SqBb(i)) || (p->tp_bb[K] & SqBb(i)))
-      key ^= zob_piece[p->pc[i]][i];
+      key ^= Zob.piece[p->pc[i]][i];
   }
 
   return key;
@@ -186,6 +179,18 @@ int StrToMove(POS *p, char *move_str) {
   return (type << 12) | (to << 6) | from;
 }
 
+int IsMoveStr(char *move_str) {
+
+  // Coordinate notation: "e2e4" or "e7e8q"
+
+  if (strlen(move_str) < 4 || strlen(move_str) > 5) return 0;
+  if (move_str[0] < 'a' || move_str[0] > 'h') return 0;
+  if (move_str[1] < '1' || move_str[1] > '8') return 0;
+  if (move_str[2] < 'a' || move_str[2] > 'h') return 0;
+  if (move_str[3] < '1' || move_str[3] > '8') return 0;
+  return 1;
+}
+
 void PvToStr(int *pv, char *pv_str) {
 
   int *movep;
@@ -205,3 +210,54 @@ void BuildPv(int *dst, int *src, int move) {
   while ((*dst++ = *src++))
     ;
 }
+
+void ClearPv(STACK_ENTRY *ss) {
+
+  ss->pv[0] = 0;
+  ss->pv_len = 0;
+}
+
+// @UpdatePv() sets pv of a node to the move followed by pv of its child.
+// Lengths are known, so the copy needs no scan for the terminating zero.
+
+void UpdatePv(STACK_ENTRY *ss, int move) {
+
+  ss->pv[0] = move;
+  memcpy(ss->pv + 1, (ss + 1)->pv, (ss + 1)->pv_len * sizeof(int));
+  ss->pv_len = (ss + 1)->pv_len + 1;
+  ss->pv[ss->pv_len] = 0;
+}
+
+// @BenchPv() measures the cost of passing a pv up from the leaf to the
+// root: with BuildPv() on separate arrays (as done before the pv table)
+// and with UpdatePv() on the search stack
+
+void BenchPv(int count) {
+
+  static int pv[MAX_PLY][MAX_PLY];
+  int depth = MAX_PLY - 1;
+  U64 updates;
+
+  if (count <= 0) count = 100000;
+  updates = (U64)count * depth;
+
+  pv[depth][0] = 0;
+  Timer.SetStartTime();
+  for (int i = 0; i < count; i++)
+    for (int ply = depth - 1; ply >= 0; ply--)
+      BuildPv(pv[ply], pv[ply + 1], ply + i);
+  int copy_time = Timer.GetElapsedTime();
+
+  ClearPv(&search_stack[depth]);
+  Timer.SetStartTime();
+  for (int i = 0; i < count; i++)
+    for (int ply = depth - 1; ply >= 0; ply--)
+      UpdatePv(&search_stack[ply], ply + i);
+  int table_time = Timer.GetElapsedTime();
+
+  // Print a checksum, so that the compiler cannot skip the work
+
+  printf("info string pv bench: %d x %d plies, checksum %d %d\n", count, depth, pv[0][depth - 1], search_stack[0].pv[depth - 1]);
+  printf("info string BuildPv() %d ms (%.2f ns per update)\n", copy_time, copy_time * 1e6 / updates);
+  printf("info string UpdatePv() %d ms (%.2f ns per update)\n", table_time, table_time * 1e6 / updates);
+}